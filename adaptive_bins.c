@@ -0,0 +1,364 @@
+/**
+ *  Implementation file for adaptive_bins.h
+ */
+
+#include "adaptive_bins.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAGIC           "CUPBIN2"
+#define MAX_BINS        (1 << 28)   // more than any sensible file has
+#define MAX_COMPRESSION (1 << 20)   // likewise for a digest
+
+// Forward declarations of helper functions.
+static void add_count(adaptive_bins*, double, size_t);
+static void start_bins(adaptive_bins*, double, size_t);
+static void cover(adaptive_bins*, double);
+static void grow_bins(adaptive_bins*, bool);
+static int bin_index(adaptive_bins*, double);
+static bool consistent(adaptive_bins*);
+static bool consistent_digest(adaptive_bins*, centroid*, size_t);
+
+/**
+ *  Creates empty bins, with no range until the data arrives.
+ */
+adaptive_bins* create_adaptive_bins(int num_bins) {
+    if(num_bins < 2) num_bins = 2;
+    num_bins += num_bins % 2;
+
+    adaptive_bins* b = malloc(sizeof(adaptive_bins));
+    b->num_bins = num_bins;
+    b->counts = calloc(num_bins, sizeof(double));
+    b->origin = 0;
+    b->width = 0;
+    b->total = 0;
+    b->min = INFINITY;
+    b->max = -INFINITY;
+    return b;
+}
+
+/**
+ *  Frees bins created by create_adaptive_bins.
+ */
+void delete_adaptive_bins(adaptive_bins* b) {
+    free(b->counts);
+    free(b);
+}
+
+/**
+ *  Adds a value to the bins.
+ */
+void add_to_bins(adaptive_bins* b, double x) {
+    add_count(b, x, 1);
+}
+
+/**
+ *  Resamples the bins. Each bin's count is spread evenly over the part
+ *  of it between the smallest and largest values, since there are no
+ *  values beyond those.
+ */
+void resample_bins(adaptive_bins* b, double x_min, double x_max,
+                   double* bins, int num_bins) {
+    if(b->total == 0) return;
+
+    // every value so far is the same
+    if(b->width == 0) {
+        spread_count(b->min, b->min, b->total, x_min, x_max, bins, num_bins);
+        return;
+    }
+
+    for(int i = 0; i < b->num_bins; i++) {
+        if(b->counts[i] == 0) continue;
+        double lo = fmax(b->origin + i * b->width, b->min);
+        double hi = fmin(b->origin + (i + 1) * b->width, b->max);
+        spread_count(lo, hi, b->counts[i], x_min, x_max, bins, num_bins);
+    }
+}
+
+/**
+ *  Spreads the values over the bins that [lo, hi] overlaps, in
+ *  proportion to the overlap.
+ */
+void spread_count(double lo, double hi, double count, double x_min,
+                  double x_max, double* bins, int num_bins) {
+    double width = (x_max - x_min) / num_bins;
+
+    if(lo >= hi) {
+        if(lo < x_min || lo > x_max) return;
+        int bin = (lo - x_min) / width;
+        if(bin >= num_bins) bin = num_bins - 1;
+        bins[bin] += count;
+        return;
+    }
+
+    double density = count / (hi - lo);
+    double first = floor((lo - x_min) / width);
+    if(first < 0) first = 0;
+    if(first >= num_bins) return;
+
+    for(int bin = first; bin < num_bins; bin++) {
+        double start = x_min + bin * width;
+        double end = bin == num_bins - 1 ? x_max : start + width;
+        if(start >= hi) break;
+
+        double overlap = fmin(hi, end) - fmax(lo, start);
+        if(overlap > 0) bins[bin] += density * overlap;
+    }
+}
+
+/**
+ *  Adds the counts in other to b. The bins of the two line up, so
+ *  every bin of other is added to the one bin of b that contains it.
+ */
+void merge_bins(adaptive_bins* b, adaptive_bins* other) {
+    if(other->total == 0) return;
+    if(other->width == 0) {
+        add_count(b, other->min, other->total);
+        return;
+    }
+
+    // if b's values are all the same, it has no bins yet. it takes on
+    // other's instead, and its values are added back at the end.
+    size_t earlier = 0;
+    double value = b->min;
+    if(b->width == 0) {
+        earlier = b->total;
+        b->total = 0;
+        b->min = INFINITY;
+        b->max = -INFINITY;
+        b->origin = other->origin;
+        b->width = other->width;
+    }
+
+    while(b->width < other->width) grow_bins(b, false);
+    cover(b, other->min);
+    cover(b, other->max);
+
+    // the bins that aren't empty hold values that b covers, and the
+    // middle of each is in the same bin of b as those values
+    for(int i = 0; i < other->num_bins; i++) {
+        if(other->counts[i] == 0) continue;
+        double middle = other->origin + (i + 0.5) * other->width;
+        b->counts[bin_index(b, middle)] += other->counts[i];
+    }
+
+    b->total += other->total;
+    if(other->min < b->min) b->min = other->min;
+    if(other->max > b->max) b->max = other->max;
+    if(earlier > 0) add_count(b, value, earlier);
+}
+
+/**
+ *  Writes the bins to a partial histogram file: a header, followed by
+ *  the counts, and then the digest's centroids if there's a digest.
+ */
+void write_bins(adaptive_bins* b, tdigest* d, const char* path) {
+    bins_header header = { MAGIC, b->num_bins, b->total, b->origin,
+                           b->width, b->min, b->max, 0, 0 };
+    if(d != NULL) {
+        flush_digest(d);
+        header.compression = d->compression;
+        header.num_centroids = d->num_centroids;
+    }
+
+    FILE* f = fopen(path, "wb");
+    if(f == NULL || fwrite(&header, sizeof(header), 1, f) != 1 ||
+       fwrite(b->counts, sizeof(double), b->num_bins, f) != b->num_bins ||
+       (d != NULL && fwrite(d->centroids, sizeof(centroid),
+                            d->num_centroids, f) != d->num_centroids) ||
+       fclose(f) != 0) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ *  Reads the bins in a partial histogram file, checking that it has
+ *  a valid header, as many counts (and centroids) as that says, and
+ *  that they all agree with each other.
+ */
+adaptive_bins* read_bins(const char* path, tdigest** d) {
+    FILE* f = fopen(path, "rb");
+    if(f == NULL) {
+        perror(path);
+        return NULL;
+    }
+
+    // a digest can't have more than compression + 1 centroids
+    bins_header h;
+    bool valid = fread(&h, sizeof(h), 1, f) == 1 &&
+                 memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 h.num_bins >= 2 && h.num_bins <= MAX_BINS &&
+                 h.num_bins % 2 == 0 && h.width >= 0 &&
+                 (h.compression == 0 ? h.num_centroids == 0 :
+                  h.compression >= 1 && h.compression <= MAX_COMPRESSION &&
+                  h.num_centroids <= h.compression + 1);
+
+    adaptive_bins* b = NULL;
+    centroid* centroids = NULL;
+    if(valid) {
+        b = create_adaptive_bins(h.num_bins);
+        b->total = h.total;
+        b->origin = h.origin;
+        b->width = h.width;
+        b->min = h.min;
+        b->max = h.max;
+
+        // there shouldn't be anything after the centroids
+        centroids = malloc(h.num_centroids * sizeof(centroid));
+        valid = fread(b->counts, sizeof(double), h.num_bins, f) ==
+                h.num_bins && fread(centroids, sizeof(centroid),
+                h.num_centroids, f) == h.num_centroids &&
+                fgetc(f) == EOF && consistent(b) &&
+                (h.compression == 0 ||
+                 consistent_digest(b, centroids, h.num_centroids));
+    }
+    fclose(f);
+
+    if(!valid) {
+        fprintf(stderr, "%s: not a valid partial histogram\n", path);
+        if(b != NULL) delete_adaptive_bins(b);
+        free(centroids);
+        return NULL;
+    }
+
+    if(d != NULL) {
+        *d = NULL;
+        if(h.compression > 0) {
+            *d = create_tdigest(h.compression);
+            add_centroids(*d, centroids, h.num_centroids, b->min, b->max);
+        }
+    }
+    free(centroids);
+    return b;
+}
+
+/** Implementations of helper functions **/
+// adds count copies of a value to the bins. until there are two
+// different values, there's nothing to base the width on, so they're
+// only counted.
+static void add_count(adaptive_bins* b, double x, size_t count) {
+    if(!isfinite(x)) return;
+
+    b->total += count;
+    if(x < b->min) b->min = x;
+    if(x > b->max) b->max = x;
+
+    if(b->width == 0) {
+        if(b->min == b->max) return;
+        start_bins(b, x, count);
+    }
+
+    cover(b, x);
+    b->counts[bin_index(b, x)] += count;
+}
+
+// sets up the range of the bins once a second value, x, comes along.
+// the width is the smallest power of two that puts the two values at
+// most half the bins apart, which leaves room for more values on the
+// side of the larger one. the earlier values (which are all the same)
+// are counted once the range is set, and x is left to the caller.
+static void start_bins(adaptive_bins* b, double x, size_t count) {
+    double earlier = x == b->min ? b->max : b->min;
+
+    // frexp splits the range into m * 2^e, with 0.5 <= m < 1
+    int e;
+    double m = frexp((b->max - b->min) / (b->num_bins / 2), &e);
+    b->width = ldexp(1, m == 0.5 ? e - 1 : e);
+    if(b->width < DBL_TRUE_MIN) b->width = DBL_TRUE_MIN;
+    b->origin = floor(b->min / b->width) * b->width;
+
+    b->counts[bin_index(b, earlier)] += b->total - count;
+}
+
+// widens the bins until they cover x.
+static void cover(adaptive_bins* b, double x) {
+    double end = b->origin + b->num_bins * b->width;
+    while(x < b->origin || x >= end) {
+        grow_bins(b, x < b->origin);
+        end = b->origin + b->num_bins * b->width;
+    }
+}
+
+// doubles the width of the bins, merging them in pairs, and extends
+// the range downwards or upwards. the range has to start at a multiple
+// of the new width, so (depending on where it started) the old bins
+// are paired up either from the first one or from the one after it.
+static void grow_bins(adaptive_bins* b, bool downwards) {
+    double width = 2 * b->width;
+    double end = b->origin + b->num_bins * b->width;
+    double origin = downwards
+                  ? ceil((end - b->num_bins * width) / width) * width
+                  : floor(b->origin / width) * width;
+
+    // the old bins are shifted along by this many old bins
+    long shift = (b->origin - origin) / b->width;
+    double* counts = calloc(b->num_bins, sizeof(double));
+    for(int i = 0; i < b->num_bins; i++) {
+        long j = (shift + i) / 2;
+        if(j > b->num_bins - 1) j = b->num_bins - 1;
+        counts[j] += b->counts[i];
+    }
+
+    free(b->counts);
+    b->counts = counts;
+    b->origin = origin;
+    b->width = width;
+}
+
+// whether bins read from a file could have been written by write_bins.
+// empty bins have no range or extremes. until two different values
+// are seen, there's no width and nothing in the bins, only the total.
+// after that, the width is a power of two, the bins start at a
+// multiple of it and cover the extremes, and the counts are whole
+// numbers that add up to the total.
+static bool consistent(adaptive_bins* b) {
+    if(b->total == 0)
+        return b->width == 0 && b->min == INFINITY && b->max == -INFINITY;
+    if(!isfinite(b->min) || !isfinite(b->max) || b->min > b->max)
+        return false;
+
+    double sum = 0;
+    for(int i = 0; i < b->num_bins; i++) {
+        double count = b->counts[i];
+        if(!(count >= 0) || count != floor(count)) return false;
+        sum += count;
+    }
+
+    if(b->width == 0) return b->min == b->max && sum == 0;
+
+    int e;
+    double end = b->origin + b->num_bins * b->width;
+    return isfinite(b->width) && frexp(b->width, &e) == 0.5 &&
+           isfinite(b->origin) && fmod(b->origin, b->width) == 0 &&
+           b->min >= b->origin && b->max < end && sum == b->total;
+}
+
+// whether the centroids of a digest read from a file could stand for
+// the same values as the bins: their means are finite, and their
+// weights are whole numbers that add up to the bins' total.
+static bool consistent_digest(adaptive_bins* b, centroid* c, size_t n) {
+    double sum = 0;
+    for(size_t i = 0; i < n; i++) {
+        if(!isfinite(c[i].mean) || !(c[i].weight >= 1) ||
+           c[i].weight != floor(c[i].weight))
+            return false;
+        sum += c[i].weight;
+    }
+
+    return sum == b->total;
+}
+
+// the bin that x is in, which has to be within the range of the bins.
+// rounding can put x just past the last bin, or before the first.
+static int bin_index(adaptive_bins* b, double x) {
+    double i = floor((x - b->origin) / b->width);
+    if(i < 0) i = 0;
+    if(i > b->num_bins - 1) i = b->num_bins - 1;
+    return i;
+}
@@ -0,0 +1,114 @@
+/**
+ *  Histogram bins that adapt to the data as it streams past, so that
+ *  a histogram can be built in a single pass without knowing the range
+ *  of the data in advance, and without storing it. There's a fixed
+ *  number of equal-width bins; whenever a value falls outside of the
+ *  range they cover, neighbouring bins are merged in pairs, doubling
+ *  their width and the range, until it fits. Memory use only depends
+ *  on the number of bins, however much data there is.
+ *
+ *  The bins can then be resampled onto any other set of bins, assuming
+ *  that the values are spread evenly within each one. The result is
+ *  off by at most the count of one of the adaptive bins at each end of
+ *  a resampled bin, so there should be many more adaptive bins than
+ *  resampled ones.
+ *
+ *  The width of the bins is always a power of two, and the bins start
+ *  at a multiple of it, so the bins of any two sets line up: each bin
+ *  of the narrower set lies inside a single bin of the wider one. That
+ *  makes merging exact, and sets built separately (on different shards
+ *  of the data, say) can be saved to partial histogram files and
+ *  merged later, with the same result as binning all of the data in
+ *  one go. A file can also hold a t-digest of the same values (see
+ *  tdigest.h), so that their quantiles can be estimated once the files
+ *  are merged. The files are written in the machine's native byte
+ *  order.
+ */
+
+#ifndef ADAPTIVE_BINS_H
+#define ADAPTIVE_BINS_H
+
+#include "tdigest.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct adaptive_bins {
+    int num_bins;           // always even
+    double* counts;
+
+    // bin i covers [origin + i * width, origin + (i + 1) * width). the
+    // width is 0 until two different values have been seen.
+    double origin, width;
+
+    size_t total;           // number of values added
+    double min, max;        // extremes of the values added
+} adaptive_bins;
+
+// the header at the start of a partial histogram file. it's followed
+// by num_bins counts, as doubles, then by the num_centroids centroids
+// of a digest of the same values, if its compression isn't 0. bin i
+// covers [origin + i * width, origin + (i + 1) * width).
+typedef struct bins_header {
+    char magic[8];
+    uint64_t num_bins, total;
+    double origin, width, min, max;
+    double compression;
+    uint64_t num_centroids;
+} bins_header;
+
+/**
+ *  Creates empty bins. An odd number of bins is rounded up, and there
+ *  are always at least 2.
+ */
+adaptive_bins* create_adaptive_bins(int num_bins);
+
+/**
+ *  Frees bins created by create_adaptive_bins.
+ */
+void delete_adaptive_bins(adaptive_bins* b);
+
+/**
+ *  Adds a value to the bins, widening them first if it's out of their
+ *  range. Values that aren't finite are ignored.
+ */
+void add_to_bins(adaptive_bins* b, double x);
+
+/**
+ *  Adds the counts in the bins to num_bins equal-width bins spanning
+ *  x_min to x_max. Values exactly at x_max go in the last bin, and any
+ *  outside of the range are left out.
+ */
+void resample_bins(adaptive_bins* b, double x_min, double x_max,
+                   double* bins, int num_bins);
+
+/**
+ *  Adds count values, spread evenly over [lo, hi], to num_bins
+ *  equal-width bins spanning x_min to x_max. If lo == hi, they all go
+ *  in one bin. Any part of [lo, hi] outside of the bins is left out.
+ */
+void spread_count(double lo, double hi, double count, double x_min,
+                  double x_max, double* bins, int num_bins);
+
+/**
+ *  Adds the counts in other to b, widening b first if other's bins are
+ *  wider or cover values outside of its range. other is left as it is.
+ */
+void merge_bins(adaptive_bins* b, adaptive_bins* other);
+
+/**
+ *  Writes the bins to a partial histogram file at the given path, along
+ *  with a digest of the same values unless d is NULL. Exits with an
+ *  error message if the file can't be written.
+ */
+void write_bins(adaptive_bins* b, tdigest* d, const char* path);
+
+/**
+ *  Reads the bins in a partial histogram file written by write_bins.
+ *  Returns NULL (after printing an error message) if it can't be read
+ *  or isn't a valid partial histogram. Unless d is NULL, it's set to
+ *  the digest saved with the bins, or NULL if there isn't one.
+ */
+adaptive_bins* read_bins(const char* path, tdigest** d);
+
+#endif
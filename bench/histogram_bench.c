@@ -0,0 +1,72 @@
+/**
+ *  Times get_freqs (see histogram.h) with 1 up to N threads, sorting
+ *  normally distributed values into the plot's bins, both on their own
+ *  and while adding them to a digest for --quantiles.
+ */
+
+#include "histogram.h"
+#include "hist_options.h"
+#include "list.h"
+#include "plot_options.h"
+#include "tdigest.h"
+#include "timing.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define NUM_VALUES  16000000
+#define WIDTH       80
+
+// a value from the standard normal distribution (box-muller)
+double normal() {
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+// times one call of get_freqs on the data, in seconds
+double time_freqs(value_list* data, int threads, bool quantiles) {
+    hist_options hist_opts = default_hist_options();
+    plot_options plot_opts = default_plot_options();
+    plot_opts.width = WIDTH;
+    plot_opts.x_min = -6;
+    plot_opts.x_max = 6;
+    plot_opts.threads = threads;
+
+    tdigest* digest = quantiles ? create_tdigest(200) : NULL;
+    double start = now();
+    double* bins = get_freqs(data, &hist_opts, digest, &plot_opts);
+    double elapsed = now() - start;
+
+    free(bins);
+    if(digest != NULL) delete_tdigest(digest);
+    return elapsed;
+}
+
+int main() {
+    value_list data = { NUM_VALUES, NUM_VALUES,
+                        malloc(NUM_VALUES * sizeof(double)) };
+    srand(1);
+    for(size_t i = 0; i < data.size; i++) data.data[i] = normal();
+
+    // at least a few threads, so there's something to compare even on
+    // a machine with a single CPU
+    int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int most = cpus > 4 ? cpus : 4;
+
+    time_freqs(&data, 1, false); // so the data is in the cache, if any
+
+    printf("%d normal values, %d CPUs\n%7s %14s %14s %16s\n", NUM_VALUES,
+           cpus, "threads", "bins", "Mvalues/s", "with quantiles");
+    for(int threads = 1; threads <= most; threads++) {
+        double bins = time_freqs(&data, threads, false);
+        double quantiles = time_freqs(&data, threads, true);
+        printf("%7d %11.1f ms %14.1f %13.1f ms\n", threads, bins * 1e3,
+               NUM_VALUES / bins / 1e6, quantiles * 1e3);
+    }
+
+    free(data.data);
+    return 0;
+}
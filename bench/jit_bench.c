@@ -0,0 +1,77 @@
+/**
+ *  Compares the ways an expression can be run over many values of x:
+ *  walking the tree, the stack machine one x at a time, the JIT (see
+ *  jit.h), and the stack machine over batches of x.
+ */
+
+#include "expression.h"
+#include "jit.h"
+#include "optimize.h"
+#include "program.h"
+#include "timing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_SAMPLES 2000000
+
+static const char* EXPRESSIONS[] = {
+    "x*x*x + 2*x*x - x/3",
+    "sin(3*x) + x^2/4",
+    "exp(x^2 / -2) * sin(10*x)",
+    "sec(x)*tan(x) - 2*3*x + exp(x^2)"
+};
+#define NUM_EXPRESSIONS (sizeof(EXPRESSIONS) / sizeof(EXPRESSIONS[0]))
+
+int main() {
+    expression_arena* arena = create_arena();
+    double* xs = malloc(NUM_SAMPLES * sizeof(double));
+    double* ys = malloc(NUM_SAMPLES * sizeof(double));
+    for(int i = 0; i < NUM_SAMPLES; i++)
+        xs[i] = -4 + 8.0 * i / NUM_SAMPLES;
+
+    printf("ns per sample\n%-34s %7s %7s %7s %7s\n", "expression",
+           "tree", "vm", "jit", "batch");
+    for(int i = 0; i < NUM_EXPRESSIONS; i++) {
+        expression* e = parse_expression(EXPRESSIONS[i], arena);
+        if(e == NULL) {
+            fprintf(stderr, "couldn't parse %s\n", EXPRESSIONS[i]);
+            return EXIT_FAILURE;
+        }
+        program* p = optimize_expression(e);
+        jit* j = compile_jit(p);
+
+        double start = now();
+        for(int k = 0; k < NUM_SAMPLES; k++) ys[k] = evaluate(e, xs[k]);
+        double tree = (now() - start) / NUM_SAMPLES * 1e9;
+
+        start = now();
+        for(int k = 0; k < NUM_SAMPLES; k++) ys[k] = run_program(p, xs[k]);
+        double vm = (now() - start) / NUM_SAMPLES * 1e9;
+
+        double native = 0;
+        if(j != NULL) {
+            start = now();
+            for(int k = 0; k < NUM_SAMPLES; k++)
+                ys[k] = j->function(xs[k]);
+            native = (now() - start) / NUM_SAMPLES * 1e9;
+        }
+
+        start = now();
+        run_program_batch(p, xs, ys, NUM_SAMPLES);
+        double batch = (now() - start) / NUM_SAMPLES * 1e9;
+
+        printf("%-34s %7.1f %7.1f ", EXPRESSIONS[i], tree, vm);
+        if(j != NULL) printf("%7.1f ", native);
+        else printf("%7s ", "n/a");
+        printf("%7.1f\n", batch);
+
+        if(j != NULL) delete_jit(j);
+        delete_program(p);
+    }
+
+    free(xs);
+    free(ys);
+    delete_arena(arena);
+    return 0;
+}
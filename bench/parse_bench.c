@@ -0,0 +1,75 @@
+/**
+ *  Times parse_expression on short expressions like the ones typed
+ *  on the command line, and on long and deeply nested generated ones.
+ */
+
+#include "expression.h"
+#include "timing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPEATS 200000
+#define LONG_LENGTH (1 << 20)
+#define NESTING 100000
+
+static const char* SHORT[] = {
+    "x",
+    "sin(3*x) + x^2/4",
+    "sec(x)*tan(x) - 2*3*x + exp(x^2)",
+    "log(x^2 + 1) / (1 + x^2) + atan(x) * 2 * 3 - acos(x / 5)"
+};
+#define NUM_SHORT (sizeof(SHORT) / sizeof(SHORT[0]))
+
+// Forward declarations of helper functions.
+static void time_parse(const char*, const char*, int,
+                       expression_arena*);
+
+int main() {
+    expression_arena* arena = create_arena();
+    for(int i = 0; i < NUM_SHORT; i++)
+        time_parse(SHORT[i], SHORT[i], REPEATS, arena);
+
+    // a long, flat sum of terms
+    char* s = malloc(LONG_LENGTH + 32);
+    size_t length = 0;
+    while(length < LONG_LENGTH)
+        length += sprintf(s + length, "%ssin(%zu.5*x)",
+                          length ? " + " : "", length % 1000);
+    time_parse("1 MB sum of sin terms", s, 20, arena);
+
+    // parentheses nested NESTING deep
+    length = 0;
+    for(int i = 0; i < NESTING; i++) s[length++] = '(';
+    s[length++] = 'x';
+    for(int i = 0; i < NESTING; i++) {
+        memcpy(s + length, "+1)", 3);
+        length += 3;
+    }
+    s[length] = '\0';
+    time_parse("100k nested parentheses", s, 20, arena);
+
+    free(s);
+    delete_arena(arena);
+    return 0;
+}
+
+/** Implementations of helper functions **/
+// parses the expression repeatedly, throwing the tree away each time,
+// and prints the time per parse and per byte.
+static void time_parse(const char* name, const char* s, int repeats,
+                       expression_arena* arena) {
+    double start = now();
+    for(int i = 0; i < repeats; i++) {
+        if(parse_expression(s, arena) == NULL) {
+            printf("%-56s doesn't parse\n", name);
+            return;
+        }
+        reset_arena(arena);
+    }
+    double seconds = (now() - start) / repeats;
+
+    printf("%-56s %10.2f us %8.1f MB/s\n", name, seconds * 1e6,
+           strlen(s) / seconds / 1e6);
+}
@@ -0,0 +1,69 @@
+/**
+ *  Compares running a compiled program (see program.h) with walking
+ *  the expression tree, one value of x at a time.
+ */
+
+#include "expression.h"
+#include "program.h"
+#include "timing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_SAMPLES 2000000
+
+static const char* EXPRESSIONS[] = {
+    "x",
+    "x^3 - 2*x^2 + x - 1",
+    "sin(x) + cos(x)",
+    "exp(x^2 / -2) * sin(10*x)",
+    "log(x^2 + 1) / (1 + x^2) + atan(x) * 2 * 3"
+};
+#define NUM_EXPRESSIONS (sizeof(EXPRESSIONS) / sizeof(EXPRESSIONS[0]))
+
+int main() {
+    expression_arena* arena = create_arena();
+    double* xs = malloc(NUM_SAMPLES * sizeof(double));
+    double* tree = malloc(NUM_SAMPLES * sizeof(double));
+    double* compiled = malloc(NUM_SAMPLES * sizeof(double));
+    for(int i = 0; i < NUM_SAMPLES; i++)
+        xs[i] = -4 + 8.0 * i / NUM_SAMPLES;
+
+    printf("%-44s %12s %12s %8s\n", "expression", "evaluate",
+           "run_program", "speedup");
+    for(int i = 0; i < NUM_EXPRESSIONS; i++) {
+        expression* e = parse_expression(EXPRESSIONS[i], arena);
+        if(e == NULL) {
+            fprintf(stderr, "couldn't parse %s\n", EXPRESSIONS[i]);
+            return EXIT_FAILURE;
+        }
+        program* p = compile_expression(e);
+
+        double start = now();
+        for(int j = 0; j < NUM_SAMPLES; j++) tree[j] = evaluate(e, xs[j]);
+        double tree_ns = (now() - start) / NUM_SAMPLES * 1e9;
+
+        start = now();
+        for(int j = 0; j < NUM_SAMPLES; j++)
+            compiled[j] = run_program(p, xs[j]);
+        double compiled_ns = (now() - start) / NUM_SAMPLES * 1e9;
+
+        // the two should give exactly the same values (NaNs aside,
+        // since they never compare equal)
+        int differences = 0;
+        for(int j = 0; j < NUM_SAMPLES; j++)
+            if(tree[j] != compiled[j] && tree[j] == tree[j]) differences++;
+
+        printf("%-44s %9.1f ns %9.1f ns %7.2fx", EXPRESSIONS[i],
+               tree_ns, compiled_ns, tree_ns / compiled_ns);
+        if(differences > 0) printf("  (%d results differ)", differences);
+        printf("\n");
+        delete_program(p);
+    }
+
+    free(tree);
+    free(compiled);
+    free(xs);
+    delete_arena(arena);
+    return 0;
+}
@@ -0,0 +1,72 @@
+/**
+ *  Times evaluate_points (see graph.h) with 1 up to N threads, on one
+ *  large batch of points and on many small batches like the levels of
+ *  adaptive sampling. The small batches are run both through a single
+ *  pool and through a new pool for every batch, which is what starting
+ *  and joining threads for each level used to cost.
+ */
+
+#include "expression.h"
+#include "graph.h"
+#include "optimize.h"
+#include "pool.h"
+#include "program.h"
+#include "timing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define EXPRESSION  "sin(1/x) * x + tan(3*x) - exp(x^2 / -2) * 2"
+#define LARGE       4000000
+#define SMALL       16384
+#define NUM_SMALL   200
+
+int main() {
+    expression_arena* arena = create_arena();
+    expression* e = parse_expression(EXPRESSION, arena);
+    program* p = optimize_expression(e);
+
+    double* xs = malloc(LARGE * sizeof(double));
+    double* ys = malloc(LARGE * sizeof(double));
+    for(int i = 0; i < LARGE; i++) xs[i] = -4 + 8.0 * i / LARGE;
+    run_program_batch(p, xs, ys, LARGE); // so ys is paged in
+
+    // at least a few threads, so there's something to compare even on
+    // a machine with a single CPU
+    int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int most = cpus > 4 ? cpus : 4;
+
+    printf("%s, %d CPUs\n%7s %14s %16s %16s\n", EXPRESSION, cpus,
+           "threads", "4M points", "200 x 16k pooled", "200 x 16k fresh");
+    for(int threads = 1; threads <= most; threads++) {
+        thread_pool* pool = create_pool(threads);
+
+        double start = now();
+        evaluate_points(pool, p, NULL, xs, ys, LARGE);
+        double large = now() - start;
+
+        start = now();
+        for(int i = 0; i < NUM_SMALL; i++)
+            evaluate_points(pool, p, NULL, xs + i * SMALL, ys, SMALL);
+        double pooled = now() - start;
+
+        start = now();
+        for(int i = 0; i < NUM_SMALL; i++) {
+            thread_pool* fresh = create_pool(threads);
+            evaluate_points(fresh, p, NULL, xs + i * SMALL, ys, SMALL);
+            delete_pool(fresh);
+        }
+        double fresh = now() - start;
+
+        printf("%7d %11.1f ms %13.1f ms %13.1f ms\n", threads,
+               large * 1e3, pooled * 1e3, fresh * 1e3);
+        delete_pool(pool);
+    }
+
+    free(xs);
+    free(ys);
+    delete_program(p);
+    delete_arena(arena);
+    return 0;
+}
@@ -0,0 +1,16 @@
+/**
+ *  Implementation file for timing.h
+ */
+
+#include "timing.h"
+
+#include <time.h>
+
+/**
+ *  Returns the time in seconds on the monotonic clock.
+ */
+double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
@@ -0,0 +1,14 @@
+/**
+ *  Timing helpers shared by the benchmarks in this directory.
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+/**
+ *  Returns the time in seconds on a monotonic clock, for measuring
+ *  how long something took.
+ */
+double now();
+
+#endif
@@ -0,0 +1,151 @@
+/**
+ *  Implementation file for contour.h
+ */
+
+#include "contour.h"
+#include "expression.h"
+#include "optimize.h"
+#include "plot.h"
+#include "plot_options.h"
+#include "pool.h"
+#include "program.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// the rows of a grid, each with a program of its own (with y folded in
+// as a constant), which are evaluated one row per task.
+typedef struct grid_rows {
+    program** programs;
+    const double* xs;
+    double* values;
+    int columns;
+} grid_rows;
+
+// Forward declarations of helper functions.
+static void evaluate_row(void*, int);
+static bool crosses(const double*, double);
+
+/**
+ *  Evaluates the expression at every corner of the plot's grid. Each
+ *  row is compiled separately, since y is the same along it, and then
+ *  the rows are evaluated on the pool's threads.
+ */
+contour_grid* sample_grid(expression* e, expression* y, thread_pool* pool,
+                          plot_options* plot_opts) {
+    contour_grid* g = malloc(sizeof(contour_grid));
+    g->columns = plot_opts->width * SUB_COLUMNS + 1;
+    g->rows = plot_opts->height * SUB_ROWS + 1;
+    g->values = malloc((size_t) g->columns * g->rows * sizeof(double));
+
+    double* xs = malloc(g->columns * sizeof(double));
+    double dx = (plot_opts->x_max - plot_opts->x_min) / (g->columns - 1);
+    for(int j = 0; j < g->columns; j++)
+        xs[j] = plot_opts->x_min + j * dx;
+
+    // the parameter is shared by the whole tree, so the programs are
+    // all compiled before any of the threads start
+    program** programs = malloc(g->rows * sizeof(program*));
+    double dy = (plot_opts->y_max - plot_opts->y_min) / (g->rows - 1);
+    for(int i = 0; i < g->rows; i++) {
+        y->value = plot_opts->y_max - i * dy;
+        programs[i] = optimize_expression(e);
+    }
+
+    grid_rows rows = { programs, xs, g->values, g->columns };
+    run_in_pool(pool, evaluate_row, &rows, g->rows);
+
+    for(int i = 0; i < g->rows; i++)
+        delete_program(programs[i]);
+    free(programs);
+    free(xs);
+    return g;
+}
+
+/**
+ *  Frees a grid created by sample_grid.
+ */
+void delete_grid(contour_grid* g) {
+    free(g->values);
+    free(g);
+}
+
+/**
+ *  Chooses n levels spread evenly between the extremes of the grid.
+ */
+bool spread_levels(contour_grid* g, double* levels, int n) {
+    double lo = INFINITY, hi = -INFINITY;
+    size_t size = (size_t) g->columns * g->rows;
+    for(size_t i = 0; i < size; i++) {
+        if(!isfinite(g->values[i])) continue;
+        if(g->values[i] < lo) lo = g->values[i];
+        if(g->values[i] > hi) hi = g->values[i];
+    }
+
+    if(lo > hi) return false;
+    for(int k = 0; k < n; k++)
+        levels[k] = lo + (hi - lo) * (k + 1) / (n + 1);
+    return true;
+}
+
+/**
+ *  Draws the level sets of the grid. Every cell of the grid is one
+ *  sextant of a character, and is filled in if the level set passes
+ *  through it for any of the levels.
+ */
+const char** grid_to_contents(contour_grid* g, const double* levels,
+                              int num_levels, plot_options* plot_opts) {
+    int plot_size = plot_opts->width * plot_opts->height;
+    int* indices = calloc(plot_size, sizeof(int));
+
+    for(int i = 0; i + 1 < g->rows; i++) {
+        for(int j = 0; j + 1 < g->columns; j++) {
+            // the corners, clockwise from the top left
+            const double* row = g->values + (size_t) i * g->columns;
+            const double* next = row + g->columns;
+            double corners[4] = { row[j], row[j + 1], next[j + 1],
+                                  next[j] };
+
+            bool filled = false;
+            for(int k = 0; k < num_levels && !filled; k++)
+                filled = crosses(corners, levels[k]);
+            if(!filled) continue;
+
+            int index = (i / SUB_ROWS) * plot_opts->width + j / SUB_COLUMNS;
+            int bit = SUB_COLUMNS * (i % SUB_ROWS) + j % SUB_COLUMNS;
+            indices[index] |= 1 << bit;
+        }
+    }
+
+    const char** contents = malloc(plot_size * sizeof(char*));
+    for(int i = 0; i < plot_size; i++)
+        contents[i] = SEXTANTS[indices[i]];
+
+    free(indices);
+    return contents;
+}
+
+/** Implementations of helper functions **/
+// evaluates row i of a grid, as a task in a pool. the programs only
+// write to their own stacks, so rows can be evaluated at the same time.
+static void evaluate_row(void* context, int i) {
+    grid_rows* rows = context;
+    run_program_batch(rows->programs[i], rows->xs,
+                      rows->values + (size_t) i * rows->columns,
+                      rows->columns);
+}
+
+// checks whether the level set passes through a cell, using the
+// marching squares case for its corners: each corner above the level
+// sets a bit, and only the cases with every bit set or none have the
+// cell entirely on one side. cells with an undefined corner have no
+// case at all.
+static bool crosses(const double* corners, double level) {
+    int c = 0;
+    for(int k = 0; k < 4; k++) {
+        if(isnan(corners[k])) return false;
+        if(corners[k] > level) c |= 1 << k;
+    }
+    return c != 0 && c != 15;
+}
@@ -0,0 +1,59 @@
+/**
+ *  Contour plots of expressions in x and y. The expression is sampled
+ *  at the corners of a grid of sub-character cells, 2 across and 3
+ *  down in each character (the same sextants that scatter plots use),
+ *  and a level set of the expression is drawn with marching squares:
+ *  a cell is filled in if its corners aren't all on the same side of
+ *  the level, which means the level set passes through it.
+ *
+ *  The rows of the grid are evaluated as compiled programs (see
+ *  program.h), a whole row at a time, and the rows are spread over the
+ *  threads of a pool (see pool.h).
+ */
+
+#ifndef CONTOUR_H
+#define CONTOUR_H
+
+#include "expression.h"
+#include "plot_options.h"
+#include "pool.h"
+
+#include <stdbool.h>
+
+// the number of sub-character cells across and down each character.
+#define SUB_COLUMNS 2
+#define SUB_ROWS 3
+
+typedef struct contour_grid {
+    int columns, rows;  // number of corners across and down
+    double* values;     // row by row, from the top left
+} contour_grid;
+
+/**
+ *  Evaluates the expression at every corner of the plot's grid. The
+ *  parameter y stands for the y-coordinate, and is changed along the
+ *  way. The rows are spread over the pool's threads.
+ */
+contour_grid* sample_grid(expression* e, expression* y, thread_pool* pool,
+                          plot_options* plot_opts);
+
+/**
+ *  Frees a grid created by sample_grid.
+ */
+void delete_grid(contour_grid* g);
+
+/**
+ *  Chooses n levels spread evenly between the lowest and highest
+ *  values in the grid (leaving those two out), storing them in levels.
+ *  Returns false if the grid has no finite values.
+ */
+bool spread_levels(contour_grid* g, double* levels, int n);
+
+/**
+ *  Draws the level sets of the grid at each of the given levels into
+ *  the plot's contents. Cells with an undefined corner are left empty.
+ */
+const char** grid_to_contents(contour_grid* g, const double* levels,
+                              int num_levels, plot_options* plot_opts);
+
+#endif
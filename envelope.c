@@ -0,0 +1,178 @@
+/** 
+ *  Implementation file for envelope.h
+ */ 
+
+#include "envelope.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+// helper function to interpolate the value at x on the line between 
+// (x0, y0) and (x1, y1). 
+static double lerp(double x0, double y0, double x1, double y1, 
+                   double x) {
+    if(x1 == x0) return y1; 
+    return y0 + (x - x0) * (y1 - y0) / (x1 - x0); 
+}
+
+/** 
+ *  Creates an empty envelope of the given number of columns covering 
+ *  the x-range [x_min, x_max]. 
+ */ 
+envelope* create_envelope(int width, double x_min, double x_max) {
+    envelope* e = calloc(1, sizeof(envelope)); 
+    e->width = width; 
+    e->x_min = x_min; 
+    e->x_max = x_max; 
+    e->columns = calloc(width, sizeof(column_summary)); 
+    return e; 
+}
+
+/** 
+ *  Frees an envelope created by create_envelope. 
+ */ 
+void delete_envelope(envelope* e) {
+    free(e->columns); 
+    free(e); 
+}
+
+/** 
+ *  Returns the column that x falls in, or -1 if it's to the left of 
+ *  the envelope and width if it's to the right. 
+ */ 
+int envelope_column(envelope* e, double x) {
+    if(x < e->x_min) return -1; 
+    if(x > e->x_max) return e->width; 
+
+    // points at exactly x_max go in the last column. 
+    double position = (x - e->x_min) / (e->x_max - e->x_min); 
+    int col = position * e->width; 
+    if(!(position >= 0) || col < 0) col = 0; 
+    if(col >= e->width) col = e->width - 1; 
+    return col; 
+}
+
+/** 
+ *  Adds the point (x, y) to the summary of the column it falls in, 
+ *  or to the nearest points outside the envelope if it's outside. 
+ */ 
+void add_to_envelope(envelope* e, double x, double y) {
+    int col = envelope_column(e, x); 
+
+    if(col < 0) {
+        if(!e->has_before || x >= e->before_x) {
+            e->has_before = true; 
+            e->before_x = x; 
+            e->before_y = y; 
+        }
+        return; 
+    }
+
+    if(col >= e->width) {
+        if(!e->has_after || x < e->after_x) {
+            e->has_after = true; 
+            e->after_x = x; 
+            e->after_y = y; 
+        }
+        return; 
+    }
+
+    column_summary point = { 1, x, y, x, y, y, y }; 
+    merge_into_envelope(e, col, &point); 
+}
+
+/** 
+ *  Merges the summary of some points that all fall in the given 
+ *  column into the envelope. 
+ */ 
+void merge_into_envelope(envelope* e, int col, column_summary* s) {
+    column_summary* c = &e->columns[col]; 
+    if(c->count == 0) {
+        *c = *s; 
+        return; 
+    }
+
+    c->count += s->count; 
+    if(s->first_x < c->first_x) {
+        c->first_x = s->first_x; 
+        c->first_y = s->first_y; 
+    }
+    if(s->last_x >= c->last_x) {
+        c->last_x = s->last_x; 
+        c->last_y = s->last_y; 
+    }
+    if(s->min < c->min) c->min = s->min; 
+    if(s->max > c->max) c->max = s->max; 
+}
+
+/** 
+ *  Converts an envelope into the range reached in each column, with 
+ *  the border values interpolated between neighbouring points. 
+ */ 
+bool envelope_ranges(envelope* e, column_range* ranges) {
+    int width = e->width; 
+
+    // for every border, the last point to its left and the first 
+    // point to its right (if there are any). 
+    bool* has_prev = malloc((width + 1) * sizeof(bool)); 
+    bool* has_next = malloc((width + 1) * sizeof(bool)); 
+    double* prev_x = malloc((width + 1) * sizeof(double)); 
+    double* prev_y = malloc((width + 1) * sizeof(double)); 
+    double* next_x = malloc((width + 1) * sizeof(double)); 
+    double* next_y = malloc((width + 1) * sizeof(double)); 
+
+    has_prev[0] = e->has_before; 
+    prev_x[0] = e->before_x; 
+    prev_y[0] = e->before_y; 
+    for(int b = 1; b <= width; b++) {
+        column_summary* c = &e->columns[b - 1]; 
+        has_prev[b] = c->count > 0 || has_prev[b - 1]; 
+        prev_x[b] = c->count > 0 ? c->last_x : prev_x[b - 1]; 
+        prev_y[b] = c->count > 0 ? c->last_y : prev_y[b - 1]; 
+    }
+
+    has_next[width] = e->has_after; 
+    next_x[width] = e->after_x; 
+    next_y[width] = e->after_y; 
+    for(int b = width - 1; b >= 0; b--) {
+        column_summary* c = &e->columns[b]; 
+        has_next[b] = c->count > 0 || has_next[b + 1]; 
+        next_x[b] = c->count > 0 ? c->first_x : next_x[b + 1]; 
+        next_y[b] = c->count > 0 ? c->first_y : next_y[b + 1]; 
+    }
+
+    bool any = has_prev[width] || has_next[0]; 
+
+    // values at each border. past either end of the data, hold the 
+    // value of the outermost point. 
+    double* borders = malloc((width + 1) * sizeof(double)); 
+    double dx = (e->x_max - e->x_min) / width; 
+    for(int b = 0; b <= width && any; b++) {
+        double x = e->x_min + b * dx; 
+        if(!has_prev[b])      borders[b] = next_y[b]; 
+        else if(!has_next[b]) borders[b] = prev_y[b]; 
+        else borders[b] = lerp(prev_x[b], prev_y[b], 
+                               next_x[b], next_y[b], x); 
+    }
+
+    for(int col = 0; col < width && any; col++) {
+        column_range* r = &ranges[col]; 
+        r->left = borders[col]; 
+        r->right = borders[col + 1]; 
+        r->min = r->left < r->right ? r->left : r->right; 
+        r->max = r->left > r->right ? r->left : r->right; 
+
+        column_summary* c = &e->columns[col]; 
+        if(c->count > 0 && c->min < r->min) r->min = c->min; 
+        if(c->count > 0 && c->max > r->max) r->max = c->max; 
+    }
+
+    free(has_prev); 
+    free(has_next); 
+    free(prev_x); 
+    free(prev_y); 
+    free(next_x); 
+    free(next_y); 
+    free(borders); 
+    return any; 
+}
@@ -0,0 +1,80 @@
+/** 
+ *  Per-column envelopes (M4 decimation) for dense graph data. Rather 
+ *  than sampling the data at the borders between columns, every point
+ *  is folded into a summary of the column it falls in: the first and 
+ *  last points (by x) together with the minimum and maximum values. 
+ *  This takes a single pass over the data in any order and O(width) 
+ *  memory, and a spike between two column borders still shows up in 
+ *  the column's maximum (or minimum). 
+ */ 
+
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// summary of the points that fall within a single column. 
+typedef struct column_summary {
+    size_t count; 
+    double first_x, first_y;    // the point with the smallest x 
+    double last_x, last_y;      // the point with the largest x 
+    double min, max;            // the range of y-values 
+} column_summary; 
+
+// the range of values a plot reaches within a column: the values at 
+// its left and right borders, and the extremes in between. 
+typedef struct column_range {
+    double left, right, min, max; 
+} column_range; 
+
+typedef struct envelope {
+    int width; 
+    double x_min, x_max; 
+    column_summary* columns; 
+
+    // the closest points on either side of [x_min, x_max], which are 
+    // needed to find the values at the outermost borders. 
+    bool has_before, has_after; 
+    double before_x, before_y, after_x, after_y; 
+} envelope; 
+
+/** 
+ *  Creates an empty envelope of the given number of columns covering 
+ *  the x-range [x_min, x_max]. 
+ */ 
+envelope* create_envelope(int width, double x_min, double x_max); 
+
+/** 
+ *  Frees an envelope created by create_envelope. 
+ */ 
+void delete_envelope(envelope* e); 
+
+/** 
+ *  Adds the point (x, y) to the summary of the column it falls in. 
+ */ 
+void add_to_envelope(envelope* e, double x, double y); 
+
+/** 
+ *  Returns the column that x falls in, or -1 if it's to the left of 
+ *  the envelope and width if it's to the right. 
+ */ 
+int envelope_column(envelope* e, double x); 
+
+/** 
+ *  Merges the summary of some points that all fall in the given 
+ *  column into the envelope. Points are assumed to arrive in order 
+ *  of x, as with add_to_envelope. 
+ */ 
+void merge_into_envelope(envelope* e, int col, column_summary* s); 
+
+/** 
+ *  Converts an envelope into the range reached in each column. The 
+ *  values at the borders are linearly interpolated between the last 
+ *  point before the border and the first point after it, exactly as 
+ *  LINEAR interpolation would, and the column's range is widened to 
+ *  include them. Returns false if the envelope has no points at all.
+ */ 
+bool envelope_ranges(envelope* e, column_range* ranges); 
+
+#endif 
@@ -1,5 +1,4 @@
 #include "expression.h" 
-#include "list.h"
 
 #include <ctype.h>
 #include <math.h>
@@ -7,31 +6,89 @@
 #include <stdlib.h>
 #include <string.h>
 
-// no tokens over 14 chars, pretty reasonable
-#define MAX_TOKEN_LENGTH 15 
+// no numbers over 63 chars, pretty reasonable
+#define MAX_TOKEN_LENGTH 64 
+
+// a block of nodes in an arena. nodes are handed out from the front
+// of the block until it's full. 
+struct arena_block {
+    struct arena_block* next;   // the previous, smaller block 
+    size_t size, capacity; 
+    expression nodes[]; 
+}; 
+
+// the smallest block that's worth allocating 
+#define MIN_BLOCK_SIZE 256 
+
+// helper function to make sure that the arena's newest block has room
+// for n more nodes, adding a bigger block if it doesn't. 
+void reserve_nodes(expression_arena* arena, size_t n) {
+    arena_block* b = arena->blocks; 
+    if(b != NULL && b->capacity - b->size >= n) return; 
+
+    size_t capacity = b == NULL ? MIN_BLOCK_SIZE : 2 * b->capacity; 
+    if(capacity < n) capacity = n; 
+
+    arena_block* block = malloc(sizeof(arena_block) + 
+                                capacity * sizeof(expression)); 
+    block->next = b; 
+    block->size = 0; 
+    block->capacity = capacity; 
+    arena->blocks = block; 
+}
+
+/** 
+ *  Creates a new, empty arena. No memory is allocated for nodes until
+ *  the first one is created. 
+ */ 
+expression_arena* create_arena() {
+    expression_arena* arena = malloc(sizeof(expression_arena)); 
+    arena->blocks = NULL; 
+    return arena; 
+}
+
+/** 
+ *  Frees every node in the arena at once. Only the newest block is 
+ *  kept, since it's the largest. 
+ */ 
+void reset_arena(expression_arena* arena) {
+    arena_block* b = arena->blocks; 
+    if(b == NULL) return; 
+
+    while(b->next != NULL) {
+        arena_block* next = b->next->next; 
+        free(b->next); 
+        b->next = next; 
+    }
+    b->size = 0; 
+}
+
+/** 
+ *  Frees the arena and all of the nodes in it. 
+ */ 
+void delete_arena(expression_arena* arena) {
+    while(arena->blocks != NULL) {
+        arena_block* next = arena->blocks->next; 
+        free(arena->blocks); 
+        arena->blocks = next; 
+    }
+    free(arena); 
+}
 
 /** 
- *  Creates a new expression node using malloc and returns a pointer
+ *  Creates a new expression node in the arena and returns a pointer
  *  to it. All pointers are initialised to the null pointers. 
  */ 
-expression* create_node() {
-    expression* e = (expression*) malloc(sizeof(expression)); 
+expression* create_node(expression_arena* arena) {
+    reserve_nodes(arena, 1); 
+    arena_block* b = arena->blocks; 
+    expression* e = &b->nodes[b->size++]; 
     e->left = NULL; 
     e->right = NULL; 
     e->value = 0; 
     return e; 
 } 
 
-/** 
- *  Deletes an entire expression tree rooted at the provided node.
- */ 
-void delete_tree(expression* tree) {
-    if(tree == NULL) return; 
-    delete_tree(tree->left); 
-    delete_tree(tree->right); 
-    free(tree); 
-} 
-
 /** 
  *  Evaluate the expression at a provided value of x. 
  */ 
@@ -43,6 +100,7 @@ double evaluate(expression* e, double x) {
         // constant value 
         case CONSTANT:  return e->value; 
         case VARIABLE:  return x; 
+        case PARAMETER: return e->value; 
 
         // arithmetic operations 
         case ADD:       return evaluate(l, x) + evaluate(r, x); 
@@ -76,32 +134,24 @@ double evaluate(expression* e, double x) {
 // syntactic unit of an expression. For instance, the expression 
 // sin(3 * x + 4) + x ^ -5 yields 12 tokens: 
 // sin, (, 3, *, x, +, 4, ), +, x, ^, -5. 
-// these tokens can be classified. The helper function converts 
-// a raw input string into a list of tokens that can be parsed. 
+// these tokens can be classified. Rather than copying each token, 
+// it just points at its characters in the input string. 
 enum token_type {
     OPERATOR,           // +-*/^, the binary operators 
     OPEN_PAREN,         // ( and ), not much to say here
     CLOSE_PAREN,    
     NUMBER,             // things like 15, -4.5, etc. 
     VAR_TOKEN,          // the variable x. 
-    STRING              // anything else, primarily functions like sin
+    STRING,             // anything else, primarily functions like sin
+    END                 // the end of the input 
 };  
 
 typedef struct token {
     enum token_type type; 
-    char contents[MAX_TOKEN_LENGTH]; 
+    const char* contents;   // not null-terminated! 
+    int length; 
 } token; 
 
-// helper function to create a new token. rather than copying the
-// entire string, it copies the first n characters in the string. 
-token* make_token(enum token_type type, const char* s, int n) {
-    token* t = (token*) malloc(sizeof(token)); 
-    t->type = type; 
-    for(int i = 0; i < n; i++) t->contents[i] = s[i]; 
-    t->contents[n] = 0; 
-    return t; 
-} 
-
 // helper function to determine if a character could be part of a 
 // numerical token or not. 
 bool in_number(char c) {
@@ -115,101 +165,65 @@ bool in_string(char c) {
            !in_number(c) && !isspace(c); 
 }
 
-// helper function to extract a numeric token from the beginning of 
-// the string. this advances the string to the last character within 
-// the token. 
-token* extract_number(const char** s) {
-    int n = 1; 
-    while(in_number((*s)[n]) && (*s)[n] != '-') { ++n; } 
-    enum token_type type = NUMBER; 
-    token* t = make_token(type, *s, n); 
-    *s += n - 1; 
-    return t; 
-} 
-
-// helper function to extract a string token from the beginning of 
-// the string. this also advances the string to the last char within
-// the token. 
-token* extract_string(const char** s) {
-    int n = 1; 
-    while(in_string((*s)[n])) { ++n; } 
-
-    // special case: the string is x, which is a variable token 
-    enum token_type type; 
-    if(**s == 'x' && n == 1) type = VAR_TOKEN; 
-    else                     type = STRING; 
+// extracts the next token from the string and advances the string 
+// past it. whitespace is skipped where possible, but it's necessary 
+// to delimit two adjacent string tokens of similar type, so "sinx" 
+// and "sin x" would be different, as would "4 5" and "45". However, 
+// "4+5" and "4 + 5" are equivalent. this does not check for the 
+// syntactic correctness of the provided string expression. 
+token next_token(const char** s) {
+    while(isspace(**s)) ++*s; 
+    token t = { END, *s, 1 }; 
+    char c = **s; 
+
+    // handle the tokens consisting of a single character 
+    if(c == 0)                          t.length = 0; 
+    else if(strchr("+*/^", c) != NULL)  t.type = OPERATOR; 
+    else if(c == '(')                   t.type = OPEN_PAREN; 
+    else if(c == ')')                   t.type = CLOSE_PAREN; 
+
+    // a '-' character may be an operator or a number. check the
+    // next character, which must be numeric and not another '-'.
+    else if(c == '-' && (!in_number((*s)[1]) || (*s)[1] == '-')) 
+        t.type = OPERATOR; 
+
+    // otherwise, we have a string, variable, or number token. 
+    // numbers may only contain a '-' as their first character. 
+    else if(in_number(c)) {
+        t.type = NUMBER; 
+        while(in_number((*s)[t.length]) && (*s)[t.length] != '-') 
+            t.length++; 
+    } else {
+        while(in_string((*s)[t.length])) t.length++; 
+
+        // special case: the string is x, which is a variable token 
+        t.type = c == 'x' && t.length == 1 ? VAR_TOKEN : STRING; 
+    }
 
-    token* t = make_token(type, *s, n); 
-    *s += n -1; 
-    return t;
+    *s += t.length; 
+    return t; 
 } 
 
+// helper function to convert a leaf token (i.e. a constant or a 
+// variable token) into a node in the expression tree. returns a 
+// null pointer for any other token. 
+expression* make_leaf(token* t, expression_arena* arena) {
+    if(t->type != VAR_TOKEN && t->type != NUMBER) return NULL; 
 
-// creates a new list and populates it with the tokens extracted
-// from the list. when possible, whitespace is ignored. whitespace is
-// necessary to delemit two adjacent string tokens of similar type,
-// so "sinx" and "sin x" would be different, as would "4 5" and "45".
-// However, "4+5" and "4 + 5" are equivalent. this does not check for
-// the syntactic correctness of the provided string expression. 
-list* tokenise(const char* s) {
-    list* tokens = create_list(); 
-    enum token_type t; 
-
-    while(*s) {
-        // skip whitespace 
-        if(isspace(*s)) { ++s; continue; }
-
-        // handle the tokens consisting of a single character 
-        if(strchr("+*/^", *s) != NULL) {
-            t = OPERATOR; 
-            append_list(tokens, make_token(t, s, 1)); 
-        } else if(*s == '(') {
-            t = OPEN_PAREN; 
-            append_list(tokens, make_token(t, s, 1)); 
-        } else if(*s == ')') {
-            t = CLOSE_PAREN; 
-            append_list(tokens, make_token(t, s, 1)); 
-        }
-
-        // a '-' character may be an operator or a number. check the
-        // next character, which must be numeric and not another '-'.
-        else if(*s == '-') {
-            if(!in_number(*(s + 1)) || *(s + 1) == '-') {
-                t = OPERATOR; 
-                append_list(tokens, make_token(t, s, 1)); 
-            } else append_list(tokens, extract_number(&s)); 
-        } 
-
-        // otherwise, we have a string, variable, or number token. 
-        else if(in_number(*s)) 
-            append_list(tokens, extract_number(&s)); 
-        else              
-            append_list(tokens, extract_string(&s)); 
-
-        ++s; 
-    } 
-
-    return tokens; 
-} 
+    // the number has to be copied out to null-terminate it
+    char contents[MAX_TOKEN_LENGTH]; 
+    if(t->length >= MAX_TOKEN_LENGTH) return NULL; 
+    memcpy(contents, t->contents, t->length); 
+    contents[t->length] = 0; 
 
-// helper function to convert a leaf token (i.e. a constant or a 
-// variable token) into a node in the expression tree. 
-expression* make_leaf(token* t) {
-    expression* e = create_node(); 
+    expression* e = create_node(arena); 
     if(t->type == VAR_TOKEN) {
         e->operation = VARIABLE; 
-    } else if(t->type == NUMBER) {
+    } else {
         e->operation = CONSTANT; 
-        e->value = strtod(t->contents, NULL); 
+        e->value = strtod(contents, NULL); 
     } 
 
-    // if it's not either of those two types, then this is an 
-    // impossible situation. 
-    else {
-        free(e);
-        return NULL; 
-    }
-
     return e; 
 } 
 
@@ -227,146 +241,201 @@ static const struct op_pair {
     {"log", LOG}, {"exp", EXP} 
 }; 
 
-// helper function to convert an interior token (i.e. an operator or
-// a function call) into an expression node, but without setting 
-// the children. 
-expression* make_node(token* t) {
+// the operators waiting on the parser's stack. binary operators bind
+// more tightly the higher their precedence, and functions bind more
+// tightly than any of them, so sin x ^ 2 is (sin x) ^ 2. an open 
+// parenthesis has the lowest precedence of all, so that nothing 
+// before it is applied until it's closed. 
+#define PAREN_PRECEDENCE    0 
+#define FUNC_PRECEDENCE     4 
+
+typedef struct pending {
     enum operators op; 
-    switch(t->type) {
-    case OPERATOR: 
+    int precedence; 
+} pending; 
+
+// helper function to convert an interior token (i.e. an operator or
+// a function call) into a pending operator. returns false if the 
+// token isn't one of those. 
+bool make_pending(token* t, pending* p) {
+    if(t->type == OPERATOR) {
         switch(t->contents[0]) {
-               case '+': op = ADD; 
-        break; case '-': op = SUBTRACT; 
-        break; case '*': op = MULTIPLY; 
-        break; case '/': op = DIVIDE; 
-        break; case '^': op = POWER; 
-        }
-    break; case STRING: 
-        int i = 0; 
-        for(; i < NUM_FUNCS; i++) {
-            if(strcmp(t->contents, STRING_TO_FUNC[i].contents) == 0) {
-                op = STRING_TO_FUNC[i].op; 
-                break; 
-            }
+               case '+': *p = (pending) { ADD, 1 }; 
+        break; case '-': *p = (pending) { SUBTRACT, 1 }; 
+        break; case '*': *p = (pending) { MULTIPLY, 2 }; 
+        break; case '/': *p = (pending) { DIVIDE, 2 }; 
+        break; case '^': *p = (pending) { POWER, 3 }; 
         }
+        return true; 
+    }
 
-        if(i == NUM_FUNCS) return NULL; // didn't match the function
-    break; default: return NULL; // improper branching point. 
+    if(t->type != STRING) return false; 
+    for(int i = 0; i < NUM_FUNCS; i++) {
+        const char* name = STRING_TO_FUNC[i].contents; 
+        if(strlen(name) == t->length && 
+           strncmp(t->contents, name, t->length) == 0) {
+            *p = (pending) { STRING_TO_FUNC[i].op, FUNC_PRECEDENCE }; 
+            return true; 
+        }
     }
 
-    expression* e = create_node(); 
-    e->operation = op; 
-    return e; 
+    return false; // didn't match the function
 } 
 
-// helper function to convert a list of tokens into a full-on 
-// expression tree. it will only convert the tokens between indices
-// start (inclusive) and end (exclusive). returns a null pointer 
-// if it could not parse the tokens. 
-expression* parse_tokens(list* tokens, size_t start, size_t end); 
-
-// helper function to make the recursive call to parse_tokens, 
-// provided an index to split the token list at. 
-expression* split_tokens(list* tokens, size_t start, size_t end, 
-                         int branch) {
-    // if the branch is -1, then there were no splitting points.
-    // the only way this is valid is if there's a pair of paren-
-    // theses around the entire expression. 
-    if(branch < 0) {
-        if(((token*)(tokens->data[start]))->type != OPEN_PAREN || 
-           ((token*)(tokens->data[end - 1]))->type != CLOSE_PAREN) 
-            return NULL; 
-
-        return parse_tokens(tokens, start + 1, end - 1); 
+// the parser's two stacks: the operators that haven't been applied 
+// yet, and the subtrees that they will be applied to. each token adds
+// at most one entry to either stack, so neither needs to grow. 
+typedef struct parser {
+    pending* operators; 
+    size_t num_operators; 
+    expression** operands; 
+    size_t num_operands; 
+    expression_arena* arena; 
+
+    // the names that may be used as parameters, and their nodes 
+    const char** names; 
+    int num_names; 
+    expression** parameters; 
+} parser; 
+
+// helper function to find the parameter that a string token names. 
+// returns a null pointer if it isn't one. 
+expression* find_parameter(token* t, parser* p) {
+    for(int i = 0; i < p->num_names; i++) {
+        if(strlen(p->names[i]) == t->length && 
+           strncmp(t->contents, p->names[i], t->length) == 0) 
+            return p->parameters[i]; 
     }
+    return NULL; 
+}
 
-    // otherwise, make the interior node, parse the one or two sides,
-    // and put them together before returning. 
-    token* branch_token = (token*) tokens->data[branch]; 
-    expression* middle = make_node(branch_token); 
-    if(!middle) return NULL;    // error with branch token
-
-    // if it's an operator, parse two sides 
-    if(branch_token->type == OPERATOR) {
-        expression* l = parse_tokens(tokens, start, branch);
-        expression* r = parse_tokens(tokens, branch + 1, end); 
-
-        // deal with parsing error
-        if(!l || !r) { 
-            delete_tree(middle); 
-            delete_tree(l); 
-            delete_tree(r); 
-            return NULL; 
-        }
+// pops the operator on top of the stack and applies it to the 
+// operand(s) on top of the other stack. 
+void reduce(parser* p) {
+    pending op = p->operators[--p->num_operators]; 
+    expression* e = create_node(p->arena); 
+    e->operation = op.op; 
+
+    if(op.precedence < FUNC_PRECEDENCE) 
+        e->right = p->operands[--p->num_operands]; 
+    e->left = p->operands[--p->num_operands]; 
+    p->operands[p->num_operands++] = e; 
+}
 
-        middle->left = l; 
-        middle->right = r; 
-        return middle; 
-    } 
+/** 
+ *  Constructs an expression tree out of a string input and returns
+ *  a pointer to the root node, which lives in the provided arena. If
+ *  the string input cannot be parsed, a null pointer is returned 
+ *  instead. 
+ */ 
+expression* parse_expression(const char* s, expression_arena* arena) {
+    return parse_with_parameters(s, NULL, 0, NULL, arena); 
+}
 
-    // if it's a function, make sure it's the first token in the
-    // list, then parse everything that's left. this is the only 
-    // way a function is the branch point! 
-    if(branch != start) return NULL; 
-    expression* arg = parse_tokens(tokens, start + 1, end); 
-    if(!arg) { delete_tree(middle); return NULL; } 
-    middle->left = arg; 
-    return middle; 
-} 
+/** 
+ *  Constructs an expression tree in which the given names may also be
+ *  used as parameters. 
+ *  
+ *  The tokens are read one at a time and parsed in a single pass 
+ *  using the shunting-yard algorithm, with every binary operator 
+ *  grouping to the right (so a - b - c is a - (b - c)). Nodes are 
+ *  created as operators are applied, which is postfix order, after 
+ *  the nodes for the parameters. 
+ */ 
+expression* parse_with_parameters(const char* s, const char** names, 
+                                  int num_names, expression** parameters,
+                                  expression_arena* arena) {
+    // count the tokens first. there's at most one node per token (and
+    // parameter), so room for all of them is reserved in one block up
+    // front. 
+    size_t num_tokens = 0; 
+    for(const char* c = s; next_token(&c).type != END; ) num_tokens++; 
+    reserve_nodes(arena, num_tokens + num_names); 
+    size_t start = arena->blocks->size; 
+
+    parser p = { malloc(num_tokens * sizeof(pending)), 0, 
+                 malloc(num_tokens * sizeof(expression*)), 0, arena, 
+                 names, num_names, 
+                 malloc(num_names * sizeof(expression*)) }; 
+    for(int i = 0; i < num_names; i++) {
+        p.parameters[i] = create_node(arena); 
+        p.parameters[i]->operation = PARAMETER; 
+    }
 
-// implementation of parse_tokens
-expression* parse_tokens(list* tokens, size_t start, size_t end) {
-    // if there's only 1 token, it has to be a leaf. 
-    if(end == start + 1) 
-        return make_leaf((token*)(tokens->data[start])); 
-
-    int num_parens = 0; 
-    int add_sub = -1, mul_div = -1, pow = -1, func = -1; 
-    for(size_t i = start; i < end; i++) {
-        token* t = (token*)(tokens->data[i]); 
-        enum token_type type = t->type; 
-
-        if(type == OPEN_PAREN) ++num_parens; 
-        if(type == CLOSE_PAREN) --num_parens; 
-        if(num_parens < 0) return NULL; 
-        if(num_parens > 0) continue; 
-
-        switch(type) {
-        case VAR_TOKEN: case NUMBER: continue; 
-        case STRING: if(func < 0) func = i; break; 
-
-        // found an operator -- check if it's +- or */ or ^
-        case OPERATOR: 
-            switch(t->contents[0]) {
-            case '+': case '-':        if(add_sub < 0) add_sub = i; 
-            break; case '*': case '/': if(mul_div < 0) mul_div = i; 
-            break; case '^':           if(pow < 0)     pow = i; 
+    bool want_operand = true; 
+    bool valid = true; 
+    pending op; 
+
+    while(valid) {
+        token t = next_token(&s); 
+
+        // an operand is a number, x, a parameter, or a parenthesised 
+        // expression, and may have any number of functions applied to 
+        // it first. 
+        if(want_operand) {
+            if(t.type == OPEN_PAREN) {
+                p.operators[p.num_operators++] = 
+                    (pending) { 0, PAREN_PRECEDENCE }; 
+            } else if(t.type == STRING && make_pending(&t, &op)) {
+                p.operators[p.num_operators++] = op; 
+            } else if(t.type == STRING && find_parameter(&t, &p)) {
+                p.operands[p.num_operands++] = find_parameter(&t, &p); 
+                want_operand = false; 
+            } else {
+                expression* leaf = make_leaf(&t, arena); 
+                if(leaf == NULL) valid = false; 
+                else p.operands[p.num_operands++] = leaf; 
+                want_operand = false; 
             }
-        break; default: 
-        } 
+            continue; 
+        }
+
+        // after an operand comes a binary operator, a closing paren,
+        // or the end of the input. the operators still on the stack 
+        // are applied as long as they bind more tightly. since equal
+        // precedence doesn't count, the operators group to the right.
+        if(t.type == OPERATOR) {
+            make_pending(&t, &op); 
+            while(p.num_operators > 0 && 
+                  p.operators[p.num_operators - 1].precedence > 
+                  op.precedence) reduce(&p); 
+            p.operators[p.num_operators++] = op; 
+            want_operand = true; 
+        } else if(t.type == CLOSE_PAREN || t.type == END) {
+            while(p.num_operators > 0 && 
+                  p.operators[p.num_operators - 1].precedence > 
+                  PAREN_PRECEDENCE) reduce(&p); 
+
+            // a closing paren needs an open one to match, and the end
+            // of the input needs there to be none left over. 
+            if((p.num_operators > 0) != (t.type == CLOSE_PAREN)) 
+                valid = false; 
+            else if(t.type == CLOSE_PAREN) p.num_operators--; 
+            else break; 
+        } else valid = false; 
     }
 
-    // mismatched parentheses - bad syntax
-    if(num_parens != 0) return NULL; 
-    
-    // reverse order of operations to make the branches 
-    int branch = -1; 
-    if(add_sub >= 0)        branch = add_sub; 
-    else if(mul_div >= 0)   branch = mul_div; 
-    else if(pow >= 0)       branch = pow; 
-    else if(func >= 0)      branch = func;
-    return split_tokens(tokens, start, end, branch); 
-} 
+    // on success there's exactly one operand left, the whole tree. 
+    // otherwise, the nodes that were created are handed back. 
+    expression* e = NULL; 
+    if(valid) {
+        e = p.operands[0]; 
+        for(int i = 0; i < num_names; i++) 
+            parameters[i] = p.parameters[i]; 
+    } else arena->blocks->size = start; 
+
+    free(p.operators); 
+    free(p.operands); 
+    free(p.parameters); 
+    return e;
+}
 
 /** 
- *  Constructs an expression tree out of a string input and returns
- *  a pointer to the root node. If the string input cannot be parsed,
- *  a null pointer is returned instead. 
+ *  Returns whether the name is one of the functions the parser knows, 
+ *  such as sin or log, and so can't be used as a parameter. 
  */ 
-expression* parse_expression(const char* s) {
-    // tokenise, then pass to recursive helper 
-    list* tokens = tokenise(s); 
-    expression* e = parse_tokens(tokens, 0, tokens->size); 
-    delete_list(tokens); 
-    return e;
-} 
+bool is_function_name(const char* name) {
+    for(int i = 0; i < NUM_FUNCS; i++) 
+        if(strcmp(STRING_TO_FUNC[i].contents, name) == 0) return true; 
+    return false; 
+}
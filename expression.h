@@ -1,6 +1,8 @@
 #ifndef EXPRESSION_H
 #define EXPRESSION_H 
 
+#include <stdbool.h>
+
 /** 
  *  The struct representing a node in an expression tree. Leaf nodes
  *  have a set value and no children whereas operator nodes (both 
@@ -9,11 +11,13 @@
  *  the children by computing recursively down the tree!
  * 
  *  In addition, this supports the presence of exactly one named 
- *  variable x so that expressions like 3 * x + 4 are valid. 
+ *  variable x so that expressions like 3 * x + 4 are valid. Other 
+ *  names can be declared as parameters, like the a in sin(a * x). A
+ *  parameter is a leaf whose value can be changed after parsing. 
  */ 
 enum operators { 
     // for leaf nodes, which could be the variable x! 
-    CONSTANT, VARIABLE, 
+    CONSTANT, VARIABLE, PARAMETER, 
 
     // basic arithmetic 
     ADD, MULTIPLY, SUBTRACT, DIVIDE, POWER, 
@@ -33,23 +37,65 @@ typedef struct expression {
 } expression; 
 
 /** 
- *  Creates a new expression node using malloc and returns a pointer
- *  to it. Nothing fancy. 
+ *  Expression nodes aren't allocated one at a time. Instead, an arena
+ *  hands them out from large blocks in the order they're created and
+ *  frees them all at once. The nodes of a parsed expression are kept
+ *  in a single block in postfix order (children before parents, as
+ *  they're evaluated), ending with the root. 
+ */ 
+typedef struct arena_block arena_block; 
+
+typedef struct expression_arena {
+    arena_block* blocks;    // the newest (and largest) block first 
+} expression_arena; 
+
+/** 
+ *  Creates a new, empty arena. 
+ */ 
+expression_arena* create_arena(); 
+
+/** 
+ *  Frees every node in the arena at once, invalidating all trees that
+ *  were built in it. The largest block is kept for reuse. 
+ */ 
+void reset_arena(expression_arena* arena); 
+
+/** 
+ *  Frees the arena and all of the nodes in it. 
  */ 
-expression* create_node(); 
+void delete_arena(expression_arena* arena); 
 
 /** 
- *  Frees all of the memory associated with an expression tree rooted
- *  at the provided node. 
- */
-void delete_tree(expression* tree); 
+ *  Creates a new expression node in the arena and returns a pointer
+ *  to it. All pointers are initialised to the null pointers. 
+ */ 
+expression* create_node(expression_arena* arena); 
 
 /** 
  *  Constructs an expression tree out of a string input and returns
- *  a pointer to the root node. If the string input cannot be parsed,
- *  a null pointer is returned instead. 
+ *  a pointer to the root node, which lives in the provided arena. If
+ *  the string input cannot be parsed, a null pointer is returned 
+ *  instead (and the arena is left as it was). 
+ */ 
+expression* parse_expression(const char* s, expression_arena* arena); 
+
+/** 
+ *  Constructs an expression tree like parse_expression, except that 
+ *  the given names may also appear in it as parameters. Each of the 
+ *  parameters is a single node, shared by all of its occurrences, and
+ *  on success a pointer to the node for names[i] is stored in 
+ *  parameters[i] (even if it doesn't occur). Its value starts at 0 
+ *  and can be set through the pointer. 
+ */ 
+expression* parse_with_parameters(const char* s, const char** names, 
+                                  int num_names, expression** parameters,
+                                  expression_arena* arena); 
+
+/** 
+ *  Returns whether the name is one of the functions the parser knows, 
+ *  such as sin or log, rather than something that can be a parameter. 
  */ 
-expression* parse_expression(const char* s); 
+bool is_function_name(const char* name); 
 
 /** 
  *  Evaluate the expression at a provided value of x. 
@@ -2,10 +2,31 @@
  *  Implementation file for graph.h 
  */ 
 
+#include "contour.h"
+#include "envelope.h" 
 #include "expression.h" 
 #include "graph.h" 
+#include "interpolate.h" 
+#include "interval.h"
+#include "jit.h"
 #include "list.h"
+#include "optimize.h"
+#include "plot.h"
 #include "plot_options.h" 
+#include "pool.h"
+#include "program.h"
+#include "pyramid.h"
+#include "reader.h"
+#include "sort.h"
+#include "sweep.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
 
 // very important constants that help us retrieve the right unicode
 // characters quickly. 
@@ -19,17 +40,66 @@ static const char* BLOCKS[RESOLUTION][RESOLUTION] = {
     {"▌", "🭐", "🭎", "🭌", "█", "█"}
 }; 
 
-// Forward declarations of the helper structs and methods involved.
-typedef struct point {
-    double x, y; 
-} point; 
-
-int compare_points(const void*, const void*); 
+// the most times a column is halved when sampling an expression, so
+// there are at most 2^MAX_SPLITS - 1 samples inside any column. 
+#define MAX_SPLITS 10 
+
+// how long each frame of a sweep stays on screen, in microseconds
+#define FRAME_DELAY 40000 
+
+// the fewest points worth handing to a thread of their own when an 
+// expression is sampled. 
+#define MIN_SLICE_SIZE 4096 
+
+// the points that one thread evaluates an expression at. 
+typedef struct slice {
+    program* p; 
+    jit* j; 
+    double* xs, * ys; 
+    int n; 
+} slice; 
+
+// a piece of a column that might need more samples, and how far one 
+// of the expressions (the curve) might reach beyond the range found in
+// the column so far. 
+typedef struct segment {
+    double a, b; 
+    int col, curve, depth; 
+    double excess; 
+} segment; 
+
+// drawn in the empty space above a column's curve, up to the highest
+// value in that column, and in the filled space below it, down to the
+// lowest value. 
+#define SPIKE   "│"
+#define DIP     "░"
+
+// Forward declarations of the helper methods involved.
+const char** blank_contents(plot_options*); 
+double* column_borders(plot_options*); 
+const char** curves_to_contents(expression**, int, program*, jit*, 
+                                thread_pool*, double*, graph_options*, 
+                                plot_options*);
+const char** envelope_to_contents(envelope*, bool, plot_options*); 
+const char** envelope_to_graph(plot_options*); 
+int compare_segments(const void*, const void*); 
+void evaluate_slice(void*, int); 
+void expand_bounds(double, double, double, double, plot_options*); 
+void fit_expression(expression*, plot_options*); 
 const char* get_block(int, int, int, plot_options*); 
-double linear_interp(list*, double); 
-const char** points_to_contents(point*, plot_options*); 
-list* read_points(FILE*); 
-void rescale_bounds(list*, plot_options*); 
+const char** index_to_graph(graph_options*, plot_options*); 
+bool needs_samples(expression*, segment*, double, double, double); 
+const char** overlay_contents(column_range*, int, plot_options*); 
+const char** points_to_contents(double*, double*, double*, 
+                                plot_options*); 
+const char* range_to_block(column_range*, int, bool, plot_options*); 
+const char** ranges_to_contents(column_range*, plot_options*); 
+point_stream* read_points(graph_options*, plot_options*); 
+bool refine_columns(expression**, int, program*, jit*, thread_pool*, 
+                    double*, double*, long, plot_options*); 
+void rescale_bounds(point_stream*, plot_options*); 
+const char** series_to_graph(graph_options*, plot_options*); 
+double sweep_value(int, graph_options*); 
 int y_to_height(double, plot_options*); 
 
 /** 
@@ -38,123 +108,550 @@ int y_to_height(double, plot_options*);
  *  interpolant, this then produces the necessary array of strings
  *  that represents the contents of the plot. 
  */ 
-const char** data_to_graph(enum interpolant i, 
+const char** data_to_graph(graph_options* graph_opts, 
                            plot_options* plot_opts) {
-    // first, obtain a list of data points from the input file
-    list* data = read_points(plot_opts->data_input); 
+    if(graph_opts->index != NULL) 
+        return index_to_graph(graph_opts, plot_opts); 
+    if(graph_opts->envelope) return envelope_to_graph(plot_opts); 
+    if(graph_opts->series > 1) 
+        return series_to_graph(graph_opts, plot_opts); 
+
+    // first, obtain a sorted stream of data points from the input
+    point_stream* data = read_points(graph_opts, plot_opts); 
     rescale_bounds(data, plot_opts); 
 
-    // next, apply the interpolation function to create an array of
-    // points corresponding to the "borders" between each column. 
-    point* points = malloc((plot_opts->width + 1) * sizeof(point));
+    // next, apply the interpolation function to find the values at
+    // the "borders" between each column. with no data at all, the 
+    // borders sit at the bottom of the plot. 
+    int num_points = plot_opts->width + 1; 
+    double* xs = malloc(num_points * sizeof(double)); 
+    double* ys = malloc(num_points * sizeof(double)); 
     double x = plot_opts->x_min; 
     double dx = (plot_opts->x_max - x) / plot_opts->width; 
 
-    for(int i = 0; i <= plot_opts->width; i++) {
-        points[i].x = x; 
-        points[i].y = linear_interp(data, x); 
+    for(int i = 0; i < num_points; i++) {
+        xs[i] = x; 
+        ys[i] = plot_opts->y_min; 
         x += dx; 
     }
+    interpolate(graph_opts->interpolant, data, xs, ys, num_points); 
         
     // convert to plot contents, then free memory and return. 
-    const char** contents = points_to_contents(points, plot_opts); 
-    free(points); 
-    delete_list(data); // no longer needed
+    const char** contents = points_to_contents(ys, NULL, NULL, 
+                                               plot_opts); 
+    free(xs); 
+    free(ys); 
+    delete_point_stream(data); // no longer needed
     return contents;    
 }
 
 /** 
- *  This function receives a string expression and a set of plotting
- *  options and uses it to compute what the plot should look like. 
- *  If the provided string expression is invalid, then the plot will
- *  be filled with empty space instead. 
+ *  This function sorts the data from the data source indicated in 
+ *  the plot options and writes a level-of-detail index of it to the 
+ *  file named in the graph options, which can later be drawn from 
+ *  with --index. 
+ */ 
+void data_to_index(graph_options* graph_opts, plot_options* plot_opts) {
+    point_stream* data = read_points(graph_opts, plot_opts); 
+    write_pyramid(data, graph_opts->build_index); 
+    delete_point_stream(data); 
+}
+
+/** 
+ *  This function receives a number of string expressions and a set of
+ *  plotting options and uses them to compute what the plot should 
+ *  look like, with the curves drawn over each other. Any expressions
+ *  that are invalid are left out, and if none of them are valid, the
+ *  plot will be filled with empty space instead. 
  */ 
-const char** expression_to_graph(char* equation, 
+const char** expression_to_graph(char** equations, int num_equations,
+                                 graph_options* graph_opts, 
                                  plot_options* plot_opts) {
-    expression* e = parse_expression(equation); 
+    expression_arena* arena = create_arena(); 
+    expression** es = malloc(num_equations * sizeof(expression*)); 
+    int n = 0; 
+    for(int i = 0; i < num_equations; i++) {
+        es[n] = parse_expression(equations[i], arena); 
+        if(es[n] != NULL) n++; 
+    }
+
+    // error parsing every expression 
+    if(n == 0) {
+        free(es); 
+        delete_arena(arena); 
+        return blank_contents(plot_opts); 
+    }
+
+    // unless told not to, widen the y-range so the whole of every 
+    // curve fits, except in columns where it shoots off towards an 
+    // asymptote. 
+    if(plot_opts->rescale) {
+        for(int i = 0; i < n; i++) 
+            fit_expression(es[i], plot_opts); 
+    }
+
+    // compute the values at the column borders again; this time, 
+    // use the equations to compute them. the expressions are 
+    // optimised and compiled together, so that the parts they have in
+    // common are only computed once, then run over all of the borders 
+    // at once. 
+    program* p = optimize_expressions(es, n); 
+    jit* j = graph_opts->jit ? compile_jit(p) : NULL; 
+    thread_pool* pool = create_pool(plot_opts->threads); 
+
+    int num_points = plot_opts->width + 1; 
+    double* xs = column_borders(plot_opts); 
+    double* ys = malloc(num_points * n * sizeof(double)); 
+    evaluate_points(pool, p, j, xs, ys, num_points); 
+
+    const char** contents = curves_to_contents(es, n, p, j, pool, ys, 
+                                               graph_opts, plot_opts);
+    delete_pool(pool); 
+    if(j != NULL) delete_jit(j); 
+    delete_program(p); 
+    delete_arena(arena); 
+    free(es); 
+    free(xs); 
+    free(ys); 
+    return contents; 
+}
+
+/** 
+ *  This function draws a plot of a string expression for each value 
+ *  of the parameter being swept, one after the other. In a terminal,
+ *  each frame is drawn over the one before, as an animation. The 
+ *  parts of the expression that only depend on x are only evaluated
+ *  once for all of the frames, and it's only compiled once. 
+ */ 
+void expression_to_frames(char* equation, graph_options* graph_opts, 
+                          plot_options* plot_opts) {
+    expression_arena* arena = create_arena(); 
+    const char* names[] = { graph_opts->sweep }; 
+    expression* parameter; 
+    expression* e = parse_with_parameters(equation, names, 1, 
+                                          &parameter, arena); 
+
+    // every frame has the same y-range, so that the axes stay still 
+    if(e != NULL && plot_opts->rescale) {
+        for(int frame = 0; frame < graph_opts->frames; frame++) {
+            parameter->value = sweep_value(frame, graph_opts); 
+            fit_expression(e, plot_opts); 
+        }
+    }
+
+    int num_points = plot_opts->width + 1; 
+    double* xs = column_borders(plot_opts); 
+    double* ys = malloc(num_points * sizeof(double)); 
+    sweep* s = e != NULL ? create_sweep(e, xs, num_points) : NULL; 
+    thread_pool* pool = create_pool(plot_opts->threads); 
+    bool terminal = isatty(STDOUT_FILENO); 
+
+    // sampling within columns needs a program as well. it reads the 
+    // parameter as it runs, so one program does for every frame. 
+    program* p = e != NULL ? optimize_with_parameters(e) : NULL; 
+    jit* j = p != NULL && graph_opts->jit ? compile_jit(p) : NULL; 
+
+    for(int frame = 0; frame < graph_opts->frames; frame++) {
+        const char** contents; 
+        if(e == NULL) contents = blank_contents(plot_opts); 
+        else {
+            parameter->value = sweep_value(frame, graph_opts); 
+            run_sweep(s, ys); 
+            contents = curves_to_contents(&e, 1, p, j, pool, ys, 
+                                          graph_opts, plot_opts); 
+        }
+
+        // go back to the top left to draw over the last frame 
+        if(terminal) printf(frame == 0 ? "\033[2J\033[H" : "\033[H"); 
+        draw_plot(contents, plot_opts); 
+        free(contents); 
+
+        if(terminal) {
+            fflush(stdout); 
+            usleep(FRAME_DELAY); 
+        }
+    }
+
+    if(s != NULL) delete_sweep(s); 
+    if(j != NULL) delete_jit(j); 
+    if(p != NULL) delete_program(p); 
+    delete_pool(pool); 
+    delete_arena(arena); 
+    free(xs); 
+    free(ys); 
+}
 
-    // error parsing expression 
+/** 
+ *  This function receives a string expression in x and y and draws 
+ *  its level sets: the curve where it's 0, or a number of contours 
+ *  spread over its range, as set in the graph options. If the 
+ *  expression is invalid, the plot will be filled with empty space. 
+ */ 
+const char** expression_to_contour(char* equation, 
+                                   graph_options* graph_opts, 
+                                   plot_options* plot_opts) {
+    expression_arena* arena = create_arena(); 
+    const char* names[] = { "y" }; 
+    expression* y; 
+    expression* e = parse_with_parameters(equation, names, 1, &y, 
+                                          arena); 
     if(e == NULL) {
-        int num_points = plot_opts->width * plot_opts->height; 
-        const char** contents = malloc(num_points * sizeof(char*)); 
-        for(int i = 0; i < num_points; i++) 
-            contents[i] = " "; 
-        return contents; 
+        delete_arena(arena); 
+        return blank_contents(plot_opts); 
     }
 
-    // create a list of points again; this time, we know how many. 
-    // use the equation to compute their values. 
-    point* points = malloc((plot_opts->width + 1) * sizeof(point)); 
+    thread_pool* pool = create_pool(plot_opts->threads); 
+    contour_grid* g = sample_grid(e, y, pool, plot_opts); 
+    delete_pool(pool); 
+    int num_levels = graph_opts->levels > 0 ? graph_opts->levels : 1; 
+    double* levels = malloc(num_levels * sizeof(double)); 
+
+    const char** contents; 
+    levels[0] = 0; 
+    if(graph_opts->levels > 0 && !spread_levels(g, levels, num_levels)) 
+        contents = blank_contents(plot_opts); 
+    else contents = grid_to_contents(g, levels, num_levels, plot_opts); 
+
+    free(levels); 
+    delete_grid(g); 
+    delete_arena(arena); 
+    return contents; 
+}
+
+/** 
+ *  Evaluates the compiled expressions at each of the given points, 
+ *  using the native code if there is any. The points are split into 
+ *  contiguous slices which are evaluated on the pool's threads, if 
+ *  there are enough of them to be worth it. The values at each point 
+ *  are stored together, one for each of the program's outputs. 
+ */ 
+void evaluate_points(thread_pool* pool, program* p, jit* j, double* xs, 
+                     double* ys, int n) {
+    int threads = pool_size(pool); 
+    if(threads > n / MIN_SLICE_SIZE) threads = n / MIN_SLICE_SIZE; 
+    if(threads < 1) threads = 1; 
+
+    slice* slices = malloc(threads * sizeof(slice)); 
+    for(int i = 0; i < threads; i++) {
+        int start = (long) n * i / threads; 
+        int stop = (long) n * (i + 1) / threads; 
+        slices[i] = (slice) { p, j, xs + start, 
+                              ys + start * p->num_outputs, 
+                              stop - start }; 
+    }
+
+    run_in_pool(pool, evaluate_slice, slices, threads); 
+    free(slices); 
+}
+
+/** Implementations of helper functions **/ 
+// creates plot contents filled with empty space. 
+const char** blank_contents(plot_options* plot_opts) {
+    int num_points = plot_opts->width * plot_opts->height; 
+    const char** contents = malloc(num_points * sizeof(char*)); 
+    for(int i = 0; i < num_points; i++) 
+        contents[i] = " "; 
+    return contents; 
+}
+
+// returns the values of x at the borders between the columns. 
+double* column_borders(plot_options* plot_opts) {
+    int num_points = plot_opts->width + 1; 
+    double* xs = malloc(num_points * sizeof(double)); 
     double x = plot_opts->x_min; 
     double dx = (plot_opts->x_max - x) / plot_opts->width; 
 
-    for(int i = 0; i <= plot_opts->width; i++) {
-        points[i].x = x; 
-        points[i].y = evaluate(e, x); 
+    for(int i = 0; i < num_points; i++) {
+        xs[i] = x; 
         x += dx; 
     }
+    return xs; 
+}
 
-    const char** contents = points_to_contents(points, plot_opts); 
-    delete_tree(e); 
+// converts the values of the expressions at the column borders into
+// the plot's contents. the values for each border are stored together,
+// one for each expression. the curves may go well beyond their values
+// at the borders within a column, so those that they might are sampled
+// more finely first, using the compiled program (and native code, if 
+// any). 
+const char** curves_to_contents(expression** es, int n, program* p, 
+                                jit* j, thread_pool* pool, double* ys, 
+                                graph_options* graph_opts, 
+                                plot_options* plot_opts) {
+    int width = plot_opts->width; 
+    double* mins = malloc(width * n * sizeof(double)); 
+    double* maxs = malloc(width * n * sizeof(double)); 
+    for(int i = 0; i < width * n; i++) {
+        double l = ys[i], r = ys[i + n]; 
+        mins[i] = l < r ? l : r; 
+        maxs[i] = l > r ? l : r; 
+    }
+
+    if(graph_opts->max_samples > 0 && 
+       !refine_columns(es, n, p, j, pool, mins, maxs, 
+                       graph_opts->max_samples, plot_opts)) 
+        fprintf(stderr, "graph: all %ld extra samples were used; some "
+                "columns may not show the curve's full range\n", 
+                graph_opts->max_samples); 
+
+    // a single curve is drawn filled in, as with data 
+    const char** contents; 
+    if(n == 1) contents = points_to_contents(ys, mins, maxs, plot_opts);
+    else {
+        column_range* ranges = malloc(width * n * sizeof(column_range));
+        for(int k = 0; k < n; k++) {
+            for(int col = 0; col < width; col++) {
+                int i = col * n + k; 
+                ranges[k * width + col] = (column_range) { 
+                    ys[i], ys[i + n], mins[i], maxs[i] 
+                }; 
+            }
+        }
+
+        contents = overlay_contents(ranges, n, plot_opts); 
+        free(ranges); 
+    }
+
+    free(mins); 
+    free(maxs); 
     return contents; 
 }
 
-/** Implementations of helper functions **/ 
-// compares two points, ordering first by x-coordinate and then
-// by y-coordinate. 
-int compare_points(const void* lhs, const void* rhs) {
-    const point* p1 = lhs, * p2 = rhs; 
+// draws the data in the input file as the envelope of the points in
+// each column. the points are streamed straight from the input rather
+// than stored, unless the bounds are needed first and the input can't
+// be rewound to read it twice. 
+const char** envelope_to_graph(plot_options* plot_opts) {
+    int fd = fileno(plot_opts->data_input); 
+    off_t start = lseek(fd, 0, SEEK_CUR); 
+    point_list* stored = NULL; 
+    double x, y; 
 
-    // comparing x-coordinates to see if they're different 
-    if(p1->x < p2->x)      return -1; 
-    else if(p1->x > p2->x) return 1;
+    if(plot_opts->rescale && start >= 0) {
+        // seekable input: find the bounds in a first pass. anything 
+        // malformed gets reported by the second one. 
+        reader* r = create_reader(plot_opts->data_input); 
+        r->quiet = true; 
+        while(read_value(r, &x) && read_value(r, &y)) 
+            expand_bounds(x, x, y, y, plot_opts); 
+        delete_reader(r); 
+        lseek(fd, start, SEEK_SET); 
+    } else if(plot_opts->rescale) {
+        stored = read_all_points(plot_opts->data_input, 
+                                 plot_opts->threads); 
+        for(size_t i = 0; i < stored->size; i++) 
+            expand_bounds(stored->x[i], stored->x[i], 
+                          stored->y[i], stored->y[i], plot_opts); 
+    }
 
-    // comparing y-coordinates now 
-    if(p1->y < p2->y)      return -1; 
-    else if(p1->y > p2->y) return 1;
+    envelope* e = create_envelope(plot_opts->width, plot_opts->x_min, 
+                                  plot_opts->x_max); 
+    if(stored != NULL) {
+        for(size_t i = 0; i < stored->size; i++) 
+            add_to_envelope(e, stored->x[i], stored->y[i]); 
+        delete_point_list(stored); 
+    } else {
+        reader* r = create_reader(plot_opts->data_input); 
+        while(read_value(r, &x) && read_value(r, &y)) 
+            add_to_envelope(e, x, y); 
+        delete_reader(r); 
+    }
 
-    // both are equal
-    return 0; 
+    const char** contents = envelope_to_contents(e, true, plot_opts); 
+    delete_envelope(e); 
+    return contents; 
 }
 
-// creates a list of points out of an input file pointer 
-list* read_points(FILE* input) {
-    list* data = create_list(); 
+// draws the data in the index file given in the graph options. only 
+// the parts of the index that cover the plotted range are read. 
+const char** index_to_graph(graph_options* graph_opts, 
+                            plot_options* plot_opts) {
+    pyramid* p = open_pyramid(graph_opts->index); 
+    if(p == NULL) exit(EXIT_FAILURE); 
+
+    pyramid_header* h = p->header; 
+    if(plot_opts->rescale && h->num_points > 0) 
+        expand_bounds(h->x_min, h->x_max, h->y_min, h->y_max, plot_opts);
+
+    envelope* e = create_envelope(plot_opts->width, plot_opts->x_min, 
+                                  plot_opts->x_max); 
+    pyramid_envelope(p, e); 
+
+    const char** contents = envelope_to_contents(e, graph_opts->envelope,
+                                                 plot_opts); 
+    delete_envelope(e); 
+    close_pyramid(p); 
+    return contents; 
+}
 
-    point* temp = malloc(sizeof(point)); 
-    while(fscanf(input, " %lf %lf", &(temp->x), &(temp->y)) != EOF) {
-        insert_sorted_list(data, temp, &compare_points); 
-        temp = malloc(sizeof(point)); 
+// converts an envelope into the plot's contents. unless full is set,
+// only the line between the values at the column borders is drawn, 
+// as with LINEAR interpolation. with no data at all, the plot is left
+// empty. 
+const char** envelope_to_contents(envelope* e, bool full, 
+                                  plot_options* plot_opts) {
+    column_range* ranges = malloc(plot_opts->width * 
+                                  sizeof(column_range)); 
+    bool any = envelope_ranges(e, ranges); 
+
+    for(int col = 0; col < plot_opts->width; col++) {
+        column_range* r = &ranges[col]; 
+        if(!any) 
+            *r = (column_range) { plot_opts->y_min, plot_opts->y_min, 
+                                  plot_opts->y_min, plot_opts->y_min }; 
+        if(!full) {
+            r->min = r->left < r->right ? r->left : r->right; 
+            r->max = r->left > r->right ? r->left : r->right; 
+        }
     }
 
-    free(temp); 
-    return data; 
-} 
+    const char** contents = ranges_to_contents(ranges, plot_opts); 
+    free(ranges); 
+    return contents; 
+}
+
+// orders segments so that those which might reach furthest beyond 
+// their column's range come first. 
+int compare_segments(const void* a, const void* b) {
+    double x = ((segment*) a)->excess, y = ((segment*) b)->excess; 
+    return (x < y) - (x > y); 
+}
+
+// evaluates a slice of the points, for one of the pool's threads. 
+// both the programs and the native code only write to their own 
+// stacks, so they can be run on several slices at once. 
+void evaluate_slice(void* context, int i) {
+    slice* s = (slice*) context + i; 
+    if(s->j == NULL) {
+        run_program_batch(s->p, s->xs, s->ys, s->n); 
+        return; 
+    }
 
-// uses the provided list of data to linearly interpolate what 
-// y should be at the specified value of x. 
-double linear_interp(list* data, double x) {
-    // if x is less than the first element of the list, set x to
-    // the smallest x value and proceed per usual. 
-    point* temp = data->data[0]; 
-    if(x < temp->x) x = temp->x; 
+    for(int k = 0; k < s->n; k++) 
+        s->ys[k] = s->j->function(s->xs[k]); 
+}
 
-    // now look for the point where x >= point.x, but x < the next
-    // point's x-coordinate. 
-    point* curr, * next; 
-    for(int i = 0; i < data->size - 1; i++) {
-        curr = data->data[i]; 
-        next = data->data[i + 1]; 
+// checks whether the expression might reach further than the tolerance
+// beyond the range from lo to hi somewhere in the segment, judging by 
+// its interval of values over the segment. 
+bool needs_samples(expression* e, segment* s, double lo, double hi, 
+                   double tolerance) {
+    interval y = evaluate_interval(e, (interval) { s->a, s->b }); 
+    if(y.lo > y.hi) return false; // not defined anywhere in it 
+
+    // a column with no values yet has an empty range
+    if(!(lo <= hi)) {
+        lo = INFINITY; 
+        hi = -INFINITY; 
+    }
 
-        if(x < curr->x || x >= next->x) continue; 
+    s->excess = fmax(lo - y.lo, y.hi - hi); 
+    if(isnan(s->excess)) s->excess = INFINITY; 
+    return s->excess > tolerance; 
+}
 
-        // perform the linear interpolation
-        double slope = (next->y - curr->y) / (next->x - curr->x); 
-        return (x - curr->x) * slope + curr->y; 
+// samples the expressions inside the columns where they might go 
+// beyond the ranges found so far, widening the ranges with the new 
+// values. the ranges for each column are stored together, one for each
+// expression. those columns are halved over and over, a level at a 
+// time, and the halves that still might are sampled at their middles.
+// every expression is evaluated at each sample, so the curves share 
+// them. when there are more of those than the budget allows, the ones 
+// that might reach furthest are sampled first. returns false if the 
+// budget ran out. 
+bool refine_columns(expression** es, int n, program* p, jit* j, 
+                    thread_pool* pool, double* mins, double* maxs, 
+                    long budget, plot_options* plot_opts) {
+    int width = plot_opts->width; 
+    double dx = (plot_opts->x_max - plot_opts->x_min) / width; 
+
+    // anything within half a sub-character step of the range would be
+    // drawn the same anyway 
+    double tolerance = (plot_opts->y_max - plot_opts->y_min) / 
+                       (plot_opts->height * (RESOLUTION - 3)) / 2; 
+
+    segment* pieces = malloc(width * n * sizeof(segment)); 
+    size_t num_pieces = 0; 
+    for(int col = 0; col < width; col++) {
+        for(int k = 0; k < n; k++) {
+            double a = plot_opts->x_min + col * dx; 
+            int i = col * n + k; 
+            segment s = { a, a + dx, col, k, 0, 0 }; 
+            if(needs_samples(es[k], &s, mins[i], maxs[i], tolerance)) 
+                pieces[num_pieces++] = s; 
+        }
     }
 
-    // return the largest y-value - x is too large for our data. 
-    return ((point*)(data->data[data->size - 1]))->y; 
+    bool complete = true; 
+    while(num_pieces > 0 && complete) {
+        if(num_pieces > budget) {
+            qsort(pieces, num_pieces, sizeof(segment), compare_segments); 
+            num_pieces = budget; 
+            complete = false; 
+        }
+
+        double* xs = malloc(num_pieces * sizeof(double)); 
+        double* ys = malloc(num_pieces * n * sizeof(double)); 
+        for(size_t i = 0; i < num_pieces; i++) 
+            xs[i] = pieces[i].a + (pieces[i].b - pieces[i].a) / 2; 
+        evaluate_points(pool, p, j, xs, ys, num_pieces); 
+        budget -= num_pieces; 
+
+        // every curve's value is a sample of its own range 
+        for(size_t i = 0; i < num_pieces * n; i++) {
+            int c = pieces[i / n].col * n + i % n; 
+            if(!isfinite(ys[i])) continue; 
+            if(!(ys[i] >= mins[c])) mins[c] = ys[i]; 
+            if(!(ys[i] <= maxs[c])) maxs[c] = ys[i]; 
+        }
+
+        // keep the halves that might still go beyond the new ranges
+        segment* next = malloc(2 * num_pieces * sizeof(segment)); 
+        size_t num_next = 0; 
+        for(size_t i = 0; i < num_pieces; i++) {
+            segment* s = &pieces[i]; 
+            if(s->depth + 1 >= MAX_SPLITS) continue; 
+
+            int c = s->col * n + s->curve; 
+            segment halves[2] = {
+                { s->a, xs[i], s->col, s->curve, s->depth + 1, 0 }, 
+                { xs[i], s->b, s->col, s->curve, s->depth + 1, 0 }
+            }; 
+            for(int h = 0; h < 2; h++) {
+                if(needs_samples(es[s->curve], &halves[h], mins[c], 
+                                 maxs[c], tolerance)) 
+                    next[num_next++] = halves[h]; 
+            }
+        }
+
+        free(pieces); 
+        free(xs); 
+        free(ys); 
+        pieces = next; 
+        num_pieces = num_next; 
+    }
+
+    free(pieces); 
+    return complete; 
+}
+
+// creates a stream of the points in the input file specified in the
+// plot options, sorted by x and then by y. if there's a memory limit,
+// the points are sorted externally so that we stay within it. 
+point_stream* read_points(graph_options* graph_opts, 
+                          plot_options* plot_opts) {
+    if(graph_opts->max_memory > 0) {
+        reader* r = create_reader(plot_opts->data_input); 
+        point_stream* data = sort_points_external(r, 
+                                 graph_opts->max_memory); 
+        delete_reader(r); 
+        return data; 
+    }
+
+    point_list* data = read_all_points(plot_opts->data_input, 
+                                       plot_opts->threads); 
+    sort_points(data); 
+    return stream_points(data); 
 } 
 
 // converts the provided value of y into the proper sub-pixel height
@@ -185,36 +682,194 @@ const char* get_block(int left, int right, int row,
     return BLOCKS[left][right]; 
 }
 
-// receives an array of points that represent the function values
-// in between each column of characters. It converts this data into
+// receives an array of the function values at the borders in 
+// between each column of characters, and optionally the lowest and
+// highest values within each column. It converts this data into
 // the array of unicode characters that represent the plot area. 
-const char** points_to_contents(point* points, 
+const char** points_to_contents(double* ys, double* mins, double* maxs,
+                                plot_options* plot_opts) {
+    column_range* ranges = malloc(plot_opts->width * 
+                                  sizeof(column_range)); 
+
+    // without the extremes, the plot never leaves the range spanned by
+    // the values at the borders of a column. 
+    for(int col = 0; col < plot_opts->width; col++) {
+        double l = ys[col], r = ys[col + 1]; 
+        ranges[col] = (column_range) { 
+            l, r, l < r ? l : r, l > r ? l : r 
+        }; 
+        if(mins != NULL) {
+            ranges[col].min = mins[col]; 
+            ranges[col].max = maxs[col]; 
+        }
+    }
+
+    const char** contents = ranges_to_contents(ranges, plot_opts); 
+    free(ranges); 
+    return contents; 
+}
+
+// receives the range reached by the plot in each column of characters
+// and converts it into the array of unicode characters that represent
+// the plot area. 
+const char** ranges_to_contents(column_range* ranges, 
                                 plot_options* plot_opts) {
     int num_points = plot_opts->width * plot_opts->height; 
     const char** contents = malloc(num_points * sizeof(char*)); 
 
     for(int col = 0; col < plot_opts->width; col++) {
         for(int row = 0; row < plot_opts->height; row++) {
-            int l = y_to_height(points[col].y, plot_opts); 
-            int r = y_to_height(points[col + 1].y, plot_opts); 
             int index = row * plot_opts->width + col; 
-            contents[index] = get_block(l, r, row, plot_opts); 
+            contents[index] = range_to_block(&ranges[col], row, true, 
+                                             plot_opts); 
+        }
+    }
+
+    return contents; 
+}
+
+// receives the ranges reached by several curves in each column of 
+// characters, one curve after the other, and draws them over each 
+// other. only the cells that each curve passes through are drawn, and
+// later curves are drawn on top of earlier ones. 
+const char** overlay_contents(column_range* ranges, int num_curves, 
+                              plot_options* plot_opts) {
+    const char** contents = blank_contents(plot_opts); 
+
+    for(int k = 0; k < num_curves; k++) {
+        for(int col = 0; col < plot_opts->width; col++) {
+            column_range* range = &ranges[k * plot_opts->width + col]; 
+            for(int row = 0; row < plot_opts->height; row++) {
+                const char* block = range_to_block(range, row, false, 
+                                                   plot_opts); 
+                if(strcmp(block, " ") != 0) 
+                    contents[row * plot_opts->width + col] = block; 
+            }
         }
     }
 
     return contents; 
 }
 
+// determines the character for a column's range on the given row. the
+// column is drawn as the line between its border values, extended by
+// a spike up to its maximum if that's higher. if it's filled, the 
+// space below the line is filled in and shaded down to its minimum if
+// that's lower; otherwise, the space below is left empty and the spike
+// goes down to the minimum as well. 
+const char* range_to_block(column_range* range, int row, bool filled,
+                           plot_options* plot_opts) {
+    int l = y_to_height(range->left, plot_opts); 
+    int r = y_to_height(range->right, plot_opts); 
+    int low = y_to_height(range->min, plot_opts); 
+    int high = y_to_height(range->max, plot_opts); 
+    int bottom = l < r ? l : r; 
+    int top = l > r ? l : r; 
+
+    int min_height = plot_opts->height - row - 1; 
+    min_height *= RESOLUTION - 3; 
+    int max_height = min_height + RESOLUTION - 3; 
+
+    // empty cells the maximum reaches into, and full cells the minimum
+    // reaches below the top of. 
+    if(top <= min_height && high > min_height) return SPIKE; 
+    if(bottom >= max_height && low < max_height) 
+        return filled ? DIP : SPIKE; 
+    if(bottom >= max_height && !filled) return " "; 
+    return get_block(l, r, row, plot_opts); 
+}
+
 // rescales the bounds in the provided plot options according to the
 // data provided. does nothing if the rescaling feature is disabled.
-void rescale_bounds(list* data, plot_options* plot_opts) {
+void rescale_bounds(point_stream* data, plot_options* plot_opts) {
     if(!plot_opts->rescale) return; 
 
-    for(int i = 0; i < data->size; i++) {
-        point* p = data->data[i]; 
-        if(p->x < plot_opts->x_min) plot_opts->x_min = p->x; 
-        if(p->x > plot_opts->x_max) plot_opts->x_max = p->x; 
-        if(p->y < plot_opts->y_min) plot_opts->y_min = p->y; 
-        if(p->y > plot_opts->y_max) plot_opts->y_max = p->y; 
+    expand_bounds(data->x_min, data->x_max, data->y_min, data->y_max, 
+                  plot_opts); 
+}
+
+// widens the bounds in the provided plot options so that they contain
+// the given ranges of x and y. 
+void expand_bounds(double x_min, double x_max, double y_min, 
+                   double y_max, plot_options* plot_opts) {
+    if(x_min < plot_opts->x_min) plot_opts->x_min = x_min; 
+    if(x_max > plot_opts->x_max) plot_opts->x_max = x_max; 
+    if(y_min < plot_opts->y_min) plot_opts->y_min = y_min; 
+    if(y_max > plot_opts->y_max) plot_opts->y_max = y_max; 
+}
+
+// widens the y-range in the provided plot options to fit the values 
+// of the expression over the x-range. 
+void fit_expression(expression* e, plot_options* plot_opts) {
+    double y_min, y_max; 
+    if(bound_expression(e, plot_opts->x_min, plot_opts->x_max, 
+                        plot_opts->width, &y_min, &y_max)) 
+        expand_bounds(plot_opts->x_min, plot_opts->x_max, y_min, y_max, 
+                      plot_opts); 
+}
+
+// returns the value of the swept parameter in the given frame. the 
+// frames are spread evenly from the start of the sweep to its end. 
+double sweep_value(int frame, graph_options* graph_opts) {
+    if(graph_opts->frames < 2) return graph_opts->sweep_start; 
+
+    double range = graph_opts->sweep_end - graph_opts->sweep_start; 
+    return graph_opts->sweep_start + 
+           range * frame / (graph_opts->frames - 1); 
+}
+
+// draws several series of data from the input file, which holds an x 
+// value followed by a y value for each series, over and over. all of 
+// the values are read in a single pass, then split into the series, 
+// which are each interpolated at the column borders on their own. an
+// incomplete record at the very end of the input is dropped. 
+const char** series_to_graph(graph_options* graph_opts, 
+                             plot_options* plot_opts) {
+    int n = graph_opts->series; 
+    value_list* values = read_all_values(plot_opts->data_input, 
+                                         plot_opts->threads); 
+    size_t records = values->size / (n + 1); 
+
+    point_stream** data = malloc(n * sizeof(point_stream*)); 
+    for(int k = 0; k < n; k++) {
+        point_list* points = create_point_list(); 
+        for(size_t i = 0; i < records; i++) {
+            double* record = values->data + i * (n + 1); 
+            append_point_list(points, record[0], record[k + 1]); 
+        }
+
+        sort_points(points); 
+        data[k] = stream_points(points); 
+        rescale_bounds(data[k], plot_opts); 
     }
+    delete_value_list(values); 
+
+    // the bounds are final now, so the borders can be placed. with no
+    // data, a series sits at the bottom of the plot. 
+    int num_points = plot_opts->width + 1; 
+    double* xs = column_borders(plot_opts); 
+    double* ys = malloc(num_points * sizeof(double)); 
+    column_range* ranges = malloc(plot_opts->width * n * 
+                                  sizeof(column_range)); 
+
+    for(int k = 0; k < n; k++) {
+        for(int i = 0; i < num_points; i++) 
+            ys[i] = plot_opts->y_min; 
+        interpolate(graph_opts->interpolant, data[k], xs, ys, num_points);
+        delete_point_stream(data[k]); 
+
+        for(int col = 0; col < plot_opts->width; col++) {
+            double l = ys[col], r = ys[col + 1]; 
+            ranges[k * plot_opts->width + col] = (column_range) { 
+                l, r, l < r ? l : r, l > r ? l : r 
+            }; 
+        }
+    }
+
+    const char** contents = overlay_contents(ranges, n, plot_opts); 
+    free(data); 
+    free(xs); 
+    free(ys); 
+    free(ranges); 
+    return contents; 
 }
@@ -4,25 +4,46 @@
  *  provides data (in the form of space-separated x/y coordinate 
  *  pairs), then an interpolation function is used to determine the
  *  shape of the graph. Otherwise, the user may supply an expression
- *  that's a function of x to graph instead. 
+ *  that's a function of x to graph instead. Several expressions, or 
+ *  several series of data, can be drawn over each other, 
+ *  and the level sets of an expression in x and y can be drawn as a 
+ *  contour plot. 
  */ 
 
 #ifndef GRAPH_H 
 #define GRAPH_H
 
+#include "graph_options.h" 
+#include "jit.h" 
 #include "plot_options.h" 
-
-enum interpolant { // not implemented yet
-    LINEAR, 
-    SPLINE, 
-    STEP
-}; 
+#include "pool.h" 
+#include "program.h" 
 
 // reads data from the data input source specified from the plot 
 // options, then determines the graph's contents from there. 
-const char** data_to_graph(enum interpolant, plot_options*); 
+const char** data_to_graph(graph_options*, plot_options*); 
+
+// sorts the data from the data input source and writes an index of 
+// it to the file named by the graph options' build_index. 
+void data_to_index(graph_options*, plot_options*); 
+
+// uses some string expressions to create the plot's contents, with 
+// all of the curves in the same plot. 
+const char** expression_to_graph(char**, int, graph_options*, 
+                                 plot_options*); 
+
+// draws a plot of a string expression for every value of the swept
+// parameter named in the graph options. 
+void expression_to_frames(char*, graph_options*, plot_options*); 
+
+// uses a string expression in x and y to create the contents of a 
+// contour plot. 
+const char** expression_to_contour(char*, graph_options*, 
+                                   plot_options*); 
 
-// uses a string expression to create the plot's contents. 
-const char** expression_to_graph(char*, plot_options*); 
+// evaluates compiled expressions (and their native code, if it isn't 
+// null) at n points, on the threads of the pool. 
+void evaluate_points(thread_pool*, program*, jit*, double*, double*, 
+                     int); 
 
 #endif 
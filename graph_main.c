@@ -1,4 +1,5 @@
 #include "graph.h"
+#include "graph_options.h"
 #include "plot.h"
 #include "plot_options.h" 
 
@@ -6,39 +7,30 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-// all non-printable argument keys need to be in the range 3##. 
-// I may separate this into its own graph_options file later, but
-// right now there's not a lot of customisability to offer. 
-#define INTERPOLATION_KEY   300             // not implemented yet 
 #define EQUATION_KEY        ARGP_KEY_ARG
 
-struct argp_option graph_params[] = {
-    {"interpolant", INTERPOLATION_KEY, "LINEAR | SPLINE | STEP", 0,
-        "The interpolant to use for user-supplied data (not "
-        "implemented yet)."}, 
-    {0}
-}; 
-
-// these are the options that we will need to keep track of
-typedef struct graph_options {
-    enum interpolant i; 
-    char* equation; 
+// helper struct that contains the graph options and plot options, 
+// as well as the equations to plot (if there are any). 
+typedef struct all_options {
+    char** equations; 
+    int num_equations; 
+    graph_options* graph_opts; 
     plot_options* plot_opts; 
-} graph_options; 
+} all_options; 
 
-// argument parser! assumes that state->input is a pointer to a 
-// graph_options struct. 
-error_t parse_graph_params(int key, char* arg, 
-                           struct argp_state* state) {
-    graph_options* opts = state->input; 
+// argument parser! assumes that state->input is a pointer to an 
+// all_options struct. everything except for the equations is passed
+// on to the children parsers. 
+error_t parse_params(int key, char* arg, struct argp_state* state) {
+    all_options* opts = state->input; 
 
-    // pass the plot_options to the child parser 
+    // pass the options to the child parsers 
     state->child_inputs[0] = opts->plot_opts; 
+    state->child_inputs[1] = opts->graph_opts; 
 
     switch(key) {
-           case INTERPOLATION_KEY: // not implemented yet
-    break; case EQUATION_KEY: 
-        opts->equation = arg; 
+           case EQUATION_KEY: 
+        opts->equations[opts->num_equations++] = arg; 
     }
 
     return 0;
@@ -47,36 +39,84 @@ error_t parse_graph_params(int key, char* arg,
 int main(int argc, char** argv) {
     // initialise the graph options 
     plot_options plot_opts = default_plot_options(); 
-    graph_options opts = {
-        LINEAR,         // interpolant
-        NULL,           // equation to plot 
-        &plot_opts
-    }; 
+    graph_options graph_opts = default_graph_options(); 
+    char** equations = malloc(argc * sizeof(char*)); 
+    all_options opts = { equations, 0, &graph_opts, &plot_opts }; 
 
     struct argp_child argp_children[] = { 
         {&plot_options_argp, 0, "General Plot Options: ", 1}, 
+        {&graph_options_argp, 0, "Graph Options: ", 2}, 
         {0} 
     }; 
-    struct argp argp = {graph_params, parse_graph_params, 
-        "[EXPRESSION]", 
+    struct argp argp = {0, parse_params, 
+        "[EXPRESSION...]", 
         "Create a continuous line plot of some interpolated data "
-        "or some function in x using unicode characters. If no "
-        "input expression is provided, it defaults to the data file; "
-        "if no data file is provided, it reads daat from stdin.", 
+        "or some function in x using unicode characters. Several "
+        "expressions are drawn over each other, on the same axes. "
+        "If no input expression is provided, it defaults to the data "
+        "file; if no data file is provided, it reads daat from stdin.", 
         argp_children
     }; 
 
     argp_parse(&argp, argc, argv, 0, 0, &opts); 
 
+    // building an index is a separate mode that doesn't draw anything
+    if(graph_opts.build_index != NULL) {
+        data_to_index(&graph_opts, &plot_opts); 
+        return 0; 
+    }
+
+    // sweeps and contour plots are of an expression, never of the data 
+    if((graph_opts.sweep != NULL || graph_opts.contour) && 
+       opts.num_equations == 0) {
+        fprintf(stderr, "graph: %s needs an expression\n", 
+                graph_opts.sweep != NULL ? "--sweep" : "--contour"); 
+        free(equations); 
+        return EXIT_FAILURE; 
+    }
+
+    // so is sweeping a parameter, which draws a whole series of plots
+    if(graph_opts.sweep != NULL) {
+        if(opts.num_equations > 1) {
+            fprintf(stderr, "graph: --sweep takes a single expression\n");
+            free(equations); 
+            return EXIT_FAILURE; 
+        }
+
+        expression_to_frames(equations[0], &graph_opts, &plot_opts); 
+        free(equations); 
+        return 0; 
+    }
+
+    // contour plots take an expression in both x and y 
+    if(graph_opts.contour) {
+        if(opts.num_equations > 1) {
+            fprintf(stderr, "graph: --contour takes a single "
+                    "expression\n"); 
+            free(equations); 
+            return EXIT_FAILURE; 
+        }
+
+        const char** content = expression_to_contour(equations[0], 
+                                                     &graph_opts, 
+                                                     &plot_opts); 
+        draw_plot(content, &plot_opts); 
+        free(content); 
+        free(equations); 
+        return 0; 
+    }
+
     // creating the plot - determine the content based on if the
-    // user has provided an equation to use or not. 
+    // user has provided any equations to use or not. 
     const char** content; 
-    if(opts.equation == NULL) 
-        content = data_to_graph(opts.i, opts.plot_opts); 
+    if(opts.num_equations == 0) 
+        content = data_to_graph(&graph_opts, &plot_opts); 
     else
-        content = expression_to_graph(opts.equation, opts.plot_opts);
+        content = expression_to_graph(equations, opts.num_equations, 
+                                      &graph_opts, &plot_opts); 
     
-    draw_plot(content, opts.plot_opts); 
+    draw_plot(content, &plot_opts); 
     free(content); 
+    free(equations); 
     return 0; 
-} 
+}
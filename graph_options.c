@@ -0,0 +1,200 @@
+/** 
+ *  Implementation file for graph_options.h
+ */ 
+
+#include "graph_options.h"
+#include "expression.h"
+
+#include <argp.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// all non-printable argp keys need to be in the range 3##. 
+#define INTERPOLATION_KEY   300
+#define MAX_MEMORY_KEY      301
+#define ENVELOPE_KEY        302
+#define BUILD_INDEX_KEY     303
+#define INDEX_KEY           304
+#define JIT_KEY             305
+#define MAX_SAMPLES_KEY     306
+#define SWEEP_KEY           307
+#define SERIES_KEY          308
+#define CONTOUR_KEY         309
+
+static struct argp_option graph_params[] = {
+    {"interpolant", INTERPOLATION_KEY, "LINEAR | SPLINE | STEP", 0,
+        "The interpolant to use for user-supplied data. Defaults to "
+        "LINEAR."}, 
+    {"max-memory", MAX_MEMORY_KEY, "SIZE", 0, "Upper limit on the "
+        "memory used to sort user-supplied data, e.g. 512M or 4G. "
+        "Larger inputs are sorted in pieces using temporary files."}, 
+    {"envelope", ENVELOPE_KEY, 0, 0, "Draw the minimum and maximum "
+        "of the data within each column, so that spikes narrower than "
+        "a column stay visible. The data doesn't need to be sorted or "
+        "stored, and the interpolant is ignored."}, 
+    {"build-index", BUILD_INDEX_KEY, "FILE", 0, "Sort the data and "
+        "write a level-of-detail index of it to FILE, rather than "
+        "drawing a plot."}, 
+    {"index", INDEX_KEY, "FILE", 0, "Draw the data from an index "
+        "written by --build-index, reading only the parts of it that "
+        "are needed for the plotted range. The data is drawn with "
+        "LINEAR interpolation (or --envelope)."}, 
+    {"jit", JIT_KEY, 0, 0, "Compile the expression to native code "
+        "(x86-64 only) rather than evaluating it in vectorised "
+        "batches. Functions like sin are then computed by libm, which"
+        " is more precise but usually slower."}, 
+    {"max-samples", MAX_SAMPLES_KEY, "NUM", 0, "Upper limit on the "
+        "extra evaluations of the expression used to fill in columns "
+        "where it changes quickly or jumps, such as near asymptotes. "
+        "Defaults to 10000; 0 turns this off."}, 
+    {"sweep", SWEEP_KEY, "NAME=START:END:FRAMES", 0, "Treat NAME as a "
+        "parameter in the expression and draw FRAMES plots, one after "
+        "the other, as it goes from START to END. In a terminal, each "
+        "frame is drawn over the last as an animation."}, 
+    {"series", SERIES_KEY, "NUM", 0, "Read NUM y values after each x "
+        "value in the data, rather than one, and draw each of them as a"
+        " separate curve in the same plot. Only the interpolated plot "
+        "supports this; --envelope and --index draw a single series, "
+        "and --max-memory is ignored."}, 
+    {"contour", CONTOUR_KEY, "LEVELS", OPTION_ARG_OPTIONAL, "Treat the "
+        "expression as a function of x and y, and draw the curve where "
+        "it's 0 or, with LEVELS, that many contours spread evenly over "
+        "its range. The plot's ranges are used as they are."}, 
+    { 0 } 
+}; 
+
+/** 
+ *  The argp struct passed to the argp parser.
+ */ 
+struct argp graph_options_argp = {
+    graph_params, parse_graph_params, 0, 0
+}; 
+
+// helper function to parse a size in bytes, with an optional K, M 
+// or G suffix and then an optional B, and nothing else after it. 
+// returns 0 if the size is invalid or doesn't fit in a size_t. 
+static size_t parse_size(const char* arg) {
+    char* end; 
+    double size = strtod(arg, &end); 
+    if(end == arg || !(size >= 0)) return 0; 
+
+    switch(*end) {
+           case 'g': case 'G': size *= 1024; // fall through
+           case 'm': case 'M': size *= 1024; // fall through
+           case 'k': case 'K': size *= 1024; end++; 
+    }
+    if(*end == 'b' || *end == 'B') end++; 
+
+    // SIZE_MAX rounds up to a power of two as a double, which is too 
+    // big itself 
+    if(*end != 0 || size >= (double) SIZE_MAX) return 0; 
+    return size; 
+}
+
+// helper function to parse a sweep of the form NAME=START:END:FRAMES
+// into the options. the name has to be a word other than x or the name 
+// of a function, which the parser would read as the function. returns 
+// false if the sweep is invalid. 
+static bool parse_sweep(char* arg, graph_options* opts) {
+    char* equals = strchr(arg, '='); 
+    if(equals == NULL || equals == arg) return false; 
+
+    for(char* c = arg; c < equals; c++) 
+        if(!isalpha(*c)) return false; 
+
+    char extra; 
+    if(sscanf(equals + 1, "%lf:%lf:%d%c", &opts->sweep_start, 
+              &opts->sweep_end, &opts->frames, &extra) != 3 || 
+       opts->frames <= 0) return false; 
+
+    *equals = 0; // the name is the start of the argument 
+    if(strcmp(arg, "x") == 0 || is_function_name(arg)) {
+        *equals = '='; 
+        return false; 
+    }
+    opts->sweep = arg; 
+    return true; 
+}
+
+/** 
+ *  The argument parser for the graph's options. It assumes that 
+ *  state->input points to a graph_options struct. 
+ */ 
+error_t parse_graph_params(int key, char* arg, 
+                           struct argp_state* state) {
+    graph_options* opts = state->input; 
+
+    switch(key) {
+           case INTERPOLATION_KEY: 
+        if(strcasecmp(arg, "linear") == 0)      
+            opts->interpolant = LINEAR; 
+        else if(strcasecmp(arg, "spline") == 0) 
+            opts->interpolant = SPLINE; 
+        else if(strcasecmp(arg, "step") == 0)   
+            opts->interpolant = STEP; 
+        else argp_error(state, "unknown interpolant '%s'", arg); 
+    break; case MAX_MEMORY_KEY: 
+        opts->max_memory = parse_size(arg); 
+        if(opts->max_memory == 0) 
+            argp_error(state, "invalid memory size '%s'", arg); 
+    break; case ENVELOPE_KEY: 
+        opts->envelope = true; 
+    break; case BUILD_INDEX_KEY: 
+        opts->build_index = arg; 
+    break; case INDEX_KEY: 
+        opts->index = arg; 
+    break; case JIT_KEY: 
+        opts->jit = true; 
+    break; case MAX_SAMPLES_KEY: 
+        opts->max_samples = strtol(arg, NULL, 0); 
+        if(opts->max_samples < 0) 
+            argp_error(state, "invalid number of samples '%s'", arg); 
+    break; case SWEEP_KEY: 
+        if(!parse_sweep(arg, opts)) 
+            argp_error(state, "invalid sweep '%s'", arg); 
+    break; case SERIES_KEY: 
+        opts->series = strtol(arg, NULL, 0); 
+        if(opts->series < 1) 
+            argp_error(state, "invalid number of series '%s'", arg); 
+    break; case CONTOUR_KEY: 
+        opts->contour = true; 
+        opts->levels = arg != NULL ? strtol(arg, NULL, 0) : 0; 
+        if(opts->levels < 0) 
+            argp_error(state, "invalid number of levels '%s'", arg); 
+    break; case ARGP_KEY_END: 
+        // y is already a variable in a contour plot 
+        if(opts->contour && opts->sweep != NULL && 
+           strcmp(opts->sweep, "y") == 0) 
+            argp_error(state, "can't sweep y with --contour"); 
+    }
+
+    return 0;
+}
+
+/** 
+ *  Creates and returns a set of default options for the graph.
+ */ 
+graph_options default_graph_options() {
+    graph_options opts = { 
+        .interpolant = LINEAR, 
+        .max_memory = 0, 
+        .envelope = false, 
+        .build_index = NULL, 
+        .index = NULL, 
+        .jit = false, 
+        .max_samples = 10000, 
+        .sweep = NULL, 
+        .sweep_start = 0, 
+        .sweep_end = 0, 
+        .frames = 1, 
+        .series = 1, 
+        .contour = false, 
+        .levels = 0
+    }; 
+
+    return opts; 
+}
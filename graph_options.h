@@ -0,0 +1,77 @@
+/** 
+ *  A header file for the options that are specific to a graph (line 
+ *  plot). This includes the interpolant used for user-supplied data 
+ *  and how much memory may be used to sort that data, but not the 
+ *  plot's axes or formatting (see plot_options for those). 
+ */ 
+
+#ifndef GRAPH_OPTIONS_H
+#define GRAPH_OPTIONS_H
+
+#include <argp.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+enum interpolant {
+    LINEAR, 
+    SPLINE, 
+    STEP
+}; 
+
+// the graph_options struct, which contains the relevant information
+// that can be used to construct a graph. 
+typedef struct graph_options {
+    // the interpolant to use for user-supplied data 
+    enum interpolant interpolant; 
+
+    // the most memory (in bytes) that may be used to sort the data. 
+    // any more than this and the data is sorted in runs which are 
+    // spilled to temporary files. 0 means there is no limit. 
+    size_t max_memory; 
+
+    // whether to draw the range of the data within each column (its
+    // min/max envelope) rather than interpolating between borders. 
+    bool envelope; 
+
+    // the level-of-detail index file to write instead of drawing a 
+    // plot, and the one to draw the data from (or NULL for neither). 
+    char* build_index; 
+    char* index; 
+
+    // whether to compile expressions to native code. 
+    bool jit; 
+
+    // the most evaluations of an expression that may be spent, on top
+    // of those at the column borders, sampling the columns where the 
+    // curve changes quickly. 
+    long max_samples; 
+
+    // the parameter to sweep through when plotting an expression (or
+    // NULL for none), the range of values it takes, and the number of
+    // frames drawn along the way. 
+    char* sweep; 
+    double sweep_start, sweep_end; 
+    int frames; 
+
+    // the number of y values that follow each x value in the data, 
+    // each of which belongs to a separate series (or curve). 
+    int series; 
+
+    // whether to draw the level sets of an expression in x and y, and
+    // how many levels to spread over its range (or 0 for just the 
+    // curve where it's 0). 
+    bool contour; 
+    int levels; 
+} graph_options; 
+
+// creates a graph_options struct initialised with the default 
+// settings. 
+graph_options default_graph_options(); 
+
+// the actual argument parser to be used with argp 
+error_t parse_graph_params(int, char*, struct argp_state*); 
+
+// the argp struct needed for argp. 
+extern struct argp graph_options_argp; 
+
+#endif
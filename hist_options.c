@@ -6,16 +6,49 @@
 
 #include <argp.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <strings.h>
 
 // all non-printable argp keys need to be in the range 4##. 
 #define RELATIVE_KEY    400
 #define FULL_WIDTH_KEY  401 
+#define STREAM_KEY      402 
+#define PARTIAL_KEY     403 
+#define MERGE_KEY       404 
+#define QUANTILES_KEY   405 
+#define BINS_KEY        406 
+#define LOG_BINS_KEY    407 
 
 static struct argp_option hist_params[] = {
     {"relative", RELATIVE_KEY, 0, 0, "Creates a plot of relative "
         "frequencies rather than absolute frequencies."}, 
     {"full-width", FULL_WIDTH_KEY, 0, 0, "Uses full-width bars "
         "instead of half-width bars for the plot."}, 
+    {"stream", STREAM_KEY, "BINS", OPTION_ARG_OPTIONAL, "Bin the data "
+        "as it's read instead of storing it, using a fixed number of "
+        "bins (16384 by default) that widen to fit the data. The bars "
+        "are then approximate, to within a bin at each end."}, 
+    {"partial", PARTIAL_KEY, "FILE", 0, "Bin the data as --stream " 
+        "does and write the bins to FILE as a partial histogram, " 
+        "instead of drawing it. With --quantiles, a summary for " 
+        "estimating them is saved too."}, 
+    {"merge", MERGE_KEY, 0, 0, "Draw the partial histograms given as " 
+        "arguments, added together, instead of reading any data. They " 
+        "can also be merged into another partial with --partial. With " 
+        "--quantiles, they all have to have been written with it."}, 
+    {"quantiles", QUANTILES_KEY, 0, 0, "Estimate the 50th, 90th, 99th "
+        "and 99.9th percentiles of the data, print them and mark them "
+        "on the plot. The estimates are within 0.79%, 0.47%, 0.16% and " 
+        "0.05% of the data of the exact percentiles."}, 
+    {"bins", BINS_KEY, "auto | fd | sturges | N", 0, "How many bins to " 
+        "sort the data into, each of which is drawn as a bar as high as " 
+        "its count across the columns it covers: by the " 
+        "Freedman-Diaconis rule, Sturges' rule, the larger of the two " 
+        "(auto), or a fixed number. By default, there are two per " 
+        "column."}, 
+    {"log-bins", LOG_BINS_KEY, 0, 0, "Space the bins evenly on a log " 
+        "scale, from the smallest positive value up, and draw them on a " 
+        "log x axis. Values that aren't positive are left out."}, 
     { 0 } 
 }; 
 
@@ -39,6 +72,32 @@ error_t parse_hist_params(int key, char* arg,
         opts->relative = true; 
     break; case FULL_WIDTH_KEY: 
         opts->full_width = true; 
+    break; case STREAM_KEY: 
+        opts->stream_bins = DEFAULT_STREAM_BINS; 
+        if(arg != NULL) opts->stream_bins = strtol(arg, NULL, 0); 
+        if(opts->stream_bins < 2) 
+            argp_error(state, "invalid number of bins '%s'", arg); 
+    break; case PARTIAL_KEY: 
+        opts->partial = arg; 
+    break; case MERGE_KEY: 
+        opts->merge = true; 
+    break; case QUANTILES_KEY: 
+        opts->quantiles = true; 
+    break; case BINS_KEY: 
+        if(strcasecmp(arg, "auto") == 0) 
+            opts->bin_rule = AUTO_BINS; 
+        else if(strcasecmp(arg, "fd") == 0) 
+            opts->bin_rule = FD_BINS; 
+        else if(strcasecmp(arg, "sturges") == 0) 
+            opts->bin_rule = STURGES_BINS; 
+        else {
+            opts->bin_rule = FIXED_BINS; 
+            opts->num_bins = strtol(arg, NULL, 0); 
+            if(opts->num_bins < 1) 
+                argp_error(state, "invalid number of bins '%s'", arg); 
+        }
+    break; case LOG_BINS_KEY: 
+        opts->log_bins = true; 
     }
 
     return 0;
@@ -50,7 +109,14 @@ error_t parse_hist_params(int key, char* arg,
 hist_options default_hist_options() {
     hist_options opts = { 
         .relative = false, 
-        .full_width = false
+        .full_width = false, 
+        .stream_bins = 0, 
+        .partial = NULL, 
+        .merge = false, 
+        .quantiles = false, 
+        .bin_rule = SCREEN_BINS, 
+        .num_bins = 0, 
+        .log_bins = false 
     }; 
 
     return opts; 
@@ -12,6 +12,20 @@
 #include <argp.h>
 #include <stdbool.h>
 
+// the number of bins kept while streaming, unless told otherwise. 
+#define DEFAULT_STREAM_BINS 16384 
+
+// the ways of choosing the number of bins: two per column of the plot, 
+// the larger of the Freedman-Diaconis and Sturges rules, either rule 
+// on its own, or a fixed number. 
+enum bin_rule {
+    SCREEN_BINS, 
+    AUTO_BINS, 
+    FD_BINS, 
+    STURGES_BINS, 
+    FIXED_BINS 
+}; 
+
 // the hist_options struct, which contains the relevant information
 // that can be used to construct a histogram plot. 
 typedef struct hist_options {
@@ -20,6 +34,25 @@ typedef struct hist_options {
 
     // using full-width or half-width unicode characters 
     bool full_width;
+
+    // the number of bins to stream the data into, rather than storing
+    // it, or 0 to store it. 
+    int stream_bins; 
+
+    // a file to write the bins to as a partial histogram, instead of 
+    // drawing them, and whether to draw the merged partial histograms 
+    // named on the command line rather than reading any data. 
+    char* partial; 
+    bool merge; 
+
+    // whether to estimate, print and mark some quantiles of the data 
+    bool quantiles; 
+
+    // how the number of bins is chosen (and the number, if it's fixed), 
+    // and whether they're spaced evenly on a log scale instead. 
+    enum bin_rule bin_rule; 
+    int num_bins; 
+    bool log_bins; 
 } hist_options; 
 
 // creates a hist_options struct initialised with the default 
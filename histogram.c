@@ -2,12 +2,20 @@
  *  Implementation file for histogram.h. 
  */ 
 
+#include "adaptive_bins.h"
 #include "histogram.h" 
 #include "hist_options.h"
 #include "list.h"
+#include "reader.h"
+#include "selection.h"
+#include "tdigest.h"
 
+#include <math.h>
+#include <pthread.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 // important constants for drawing full-width and half-width bars. 
 #define FULL_WIDTH_RES 9 
@@ -23,11 +31,50 @@ const char* HALF_WIDTH_BARS[HALF_WIDTH_RES][HALF_WIDTH_RES] = {
     {"▌", "🬲", "🬺", "█"}
 }; 
 
+// the fewest values worth handing to a thread of their own when the 
+// data is sorted into bins. 
+#define MIN_SLICE_SIZE 65536 
+
+// the quantiles that are estimated with --quantiles, the compression of 
+// the digests that estimate them (see tdigest.h for what that means 
+// for their accuracy), and the marker that shows them on the plot. 
+#define NUM_QUANTILES 4 
+const double QUANTILES[NUM_QUANTILES] = { 0.5, 0.9, 0.99, 0.999 }; 
+#define DIGEST_COMPRESSION 200 
+#define QUANTILE_MARKER "┊" 
+
+// the most bins that --bins can choose (or be given), so that a very 
+// narrow spread of most of the data can't run away with the memory. 
+#define MAX_CHOSEN_BINS 65536 
+
+// the values that one thread sorts into bins. the counts are its own, 
+// and are added up once every thread is done. there's an extra count 
+// at the end, which collects the values outside of the bins. 
+typedef struct bin_slice {
+    const double* values; 
+    size_t n; 
+    double x_min, x_max, bin_width; 
+    int num_bins; 
+    bool logarithmic;   // whether the bins are of log(x) rather than x 
+
+    size_t* counts; 
+    tdigest* digest;    // NULL unless quantiles are wanted 
+} bin_slice; 
+
 // helper functions and structs, which are implemented later. 
+void* bin_values(void*); 
 int compare_data(const void*, const void*); 
-list* read_data(FILE*); 
-void rescale_plot(list*, hist_options*, plot_options*); 
-double* get_freqs(list*, bool, plot_options*); 
+void rescale_plot(value_list*, hist_options*, plot_options*); 
+void rescale_to_range(double, double, size_t, hist_options*, 
+                      plot_options*); 
+int choose_bins(value_list*, hist_options*, int, double*, double*, bool*); 
+size_t partition_values(value_list*, bool, double*); 
+double* stream_freqs(hist_options*, tdigest*, plot_options*); 
+adaptive_bins* read_into_bins(int, tdigest*, plot_options*); 
+adaptive_bins* read_partials(char**, int, tdigest*); 
+double* bins_to_freqs(adaptive_bins*, hist_options*, plot_options*); 
+const char** freqs_to_contents(double*, hist_options*, plot_options*); 
+void mark_quantiles(const char**, tdigest*, plot_options*); 
 const char** make_full_content(double*, plot_options*); 
 const char** make_half_content(double*, plot_options*); 
 
@@ -37,95 +84,485 @@ const char** make_half_content(double*, plot_options*);
  */ 
 const char** data_to_histogram(hist_options* hist_opts, 
                                plot_options* plot_opts) {
-    // read the raw data and rescale data accordingly. 
-    list* data = read_data(plot_opts->data_input); 
-    rescale_plot(data, hist_opts, plot_opts); 
+    // the quantiles are estimated in the same pass as the binning. 
+    tdigest* digest = NULL; 
+    if(hist_opts->quantiles) 
+        digest = create_tdigest(DIGEST_COMPRESSION); 
+
+    // when streaming, the data is binned as it's read, and never 
+    // stored. 
+    double* bars; 
+    if(hist_opts->stream_bins > 0) 
+        bars = stream_freqs(hist_opts, digest, plot_opts); 
+    else {
+        // read the raw data and rescale data accordingly. 
+        value_list* data = read_all_values(plot_opts->data_input, 
+                                           plot_opts->threads); 
+        rescale_plot(data, hist_opts, plot_opts); 
+
+        // create the bars in plot coordinates. 
+        bars = get_freqs(data, hist_opts, digest, plot_opts); 
+        delete_value_list(data); 
+    }
 
-    // create the bars in plot coordinates, then create the contents.
-    double* bars = get_freqs(data, hist_opts->relative, plot_opts); 
+    const char** contents = freqs_to_contents(bars, hist_opts, plot_opts); 
+    if(digest != NULL) {
+        mark_quantiles(contents, digest, plot_opts); 
+        delete_tdigest(digest); 
+    }
 
-    // populate the contents, free memory, then return. 
-    const char** contents; 
-    if(hist_opts->full_width)
-        contents = make_full_content(bars, plot_opts); 
-    else 
-        contents = make_half_content(bars, plot_opts); 
-    
-    free(bars); 
-    delete_list(data); 
     return contents; 
 }
 
-/** Implementations of helper functions. **/ 
-// reads in a list of data points from the provided input file. 
-list* read_data(FILE* fp) {
-    list* data = create_list(); 
-    double* temp = malloc(sizeof(double)); 
-    
-    while(fscanf(fp, " %lf", temp) != EOF) {
-        append_list(data, temp); 
-        temp = malloc(sizeof(double)); 
+/** 
+ *  Bins the data from the input file provided in the plot options (or 
+ *  adds up the partial histograms in the given files, if the options 
+ *  say to merge them), then writes the bins to a partial histogram 
+ *  file for merging later. The file holds a digest of the data too if 
+ *  the options ask for quantiles. 
+ */ 
+void write_partial(char** paths, int num_paths, hist_options* hist_opts, 
+                   plot_options* plot_opts) {
+    tdigest* digest = NULL; 
+    if(hist_opts->quantiles) 
+        digest = create_tdigest(DIGEST_COMPRESSION); 
+
+    adaptive_bins* b; 
+    if(hist_opts->merge) 
+        b = read_partials(paths, num_paths, digest); 
+    else {
+        int num_bins = hist_opts->stream_bins; 
+        if(num_bins == 0) num_bins = DEFAULT_STREAM_BINS; 
+        b = read_into_bins(num_bins, digest, plot_opts); 
     }
 
-    free(temp); 
-    return data; 
+    write_bins(b, digest, hist_opts->partial); 
+    delete_adaptive_bins(b); 
+    if(digest != NULL) delete_tdigest(digest); 
 }
 
+/** 
+ *  Adds up the partial histograms in the given files, then constructs 
+ *  a histogram out of them in the same way as for streamed data. 
+ */ 
+const char** partials_to_histogram(char** paths, int num_paths, 
+                                   hist_options* hist_opts, 
+                                   plot_options* plot_opts) {
+    tdigest* digest = NULL; 
+    if(hist_opts->quantiles) 
+        digest = create_tdigest(DIGEST_COMPRESSION); 
+
+    adaptive_bins* b = read_partials(paths, num_paths, digest); 
+    double* bars = bins_to_freqs(b, hist_opts, plot_opts); 
+    delete_adaptive_bins(b); 
+
+    const char** contents = freqs_to_contents(bars, hist_opts, plot_opts); 
+    if(digest != NULL) {
+        mark_quantiles(contents, digest, plot_opts); 
+        delete_tdigest(digest); 
+    }
+
+    return contents; 
+}
+
+/** Implementations of helper functions. **/ 
 // rescales a plot according to the features of the list of data 
 // points to plot. 
-void rescale_plot(list* data, hist_options* hist_opts, 
+void rescale_plot(value_list* data, hist_options* hist_opts, 
                   plot_options* plot_opts) {
     // don't do anything if the plot isn't to be rescaled 
     if(!plot_opts->rescale) return; 
 
+    // otherwise, find the minimum and maximum data points. 
+    double min = plot_opts->x_min, max = plot_opts->x_max, temp; 
+    for(size_t i = 0; i < data->size; i++) {
+        temp = data->data[i]; 
+        if(temp < min) min = temp; 
+        if(temp > max) max = temp; 
+    }
+
+    rescale_to_range(min, max, data->size, hist_opts, plot_opts); 
+}
+
+// rescales a plot to fit the given number of data points, which 
+// range from min to max. 
+void rescale_to_range(double min, double max, size_t count, 
+                      hist_options* hist_opts, plot_options* plot_opts) {
+    // don't do anything if the plot isn't to be rescaled 
+    if(!plot_opts->rescale) return; 
+
     // otherwise, set the x axis scale to the minimum and maximum
     // data points, if a rescaling is needed. 
-    double temp; 
-    for(int i = 0; i < data->size; i++) {
-        temp = *(double*)(data->data[i]); 
-        if(temp < plot_opts->x_min) plot_opts->x_min = temp; 
-        if(temp > plot_opts->x_max) plot_opts->x_max = temp; 
-    }
+    if(min < plot_opts->x_min) plot_opts->x_min = min; 
+    if(max > plot_opts->x_max) plot_opts->x_max = max; 
 
     // the y-min MUST be zero, under any and all circumstances. 
     plot_opts->y_min = 0; 
 
     // rescale y-max to be the maximum absolute/relative frequency.
     if(hist_opts->relative) plot_opts->y_max = 1; 
-    else                    plot_opts->y_max = data->size; 
+    else                    plot_opts->y_max = count; 
 }
 
 // retrieves an array of absolute or relative frequencies for each
 // bin, where the bins are determined based on the plot options.
-// two bins are created per plot column. 
-double* get_freqs(list* data, bool relative, 
-                  plot_options* plot_opts) {
+// two bins are created per plot column. the data is split into 
+// contiguous slices which are binned in parallel, if there's enough 
+// of it to be worth it. if there's a digest, each slice is also added 
+// to one of its own, and those are merged into it at the end. 
+double* get_freqs(value_list* data, hist_options* hist_opts, 
+                  tdigest* digest, plot_options* plot_opts) {
     int num_bins = plot_opts->width * 2; 
     double* bins = calloc(num_bins, sizeof(double)); 
 
-    double bin_width = (plot_opts->x_max - plot_opts->x_min); 
-    bin_width /= num_bins; 
-
-    for(int i = 0; i < data->size; i++) {
-        double x = *(double*)(data->data[i]); 
-        int bin = (x - plot_opts->x_min) / bin_width; 
+    // unless the options say to choose the bins some other way, the 
+    // data is binned straight into the plot's bins. otherwise, the 
+    // chosen bins are drawn over the plot's bins at the end. 
+    bool chosen = hist_opts->bin_rule != SCREEN_BINS || hist_opts->log_bins; 
+    double lo = plot_opts->x_min, hi = plot_opts->x_max; 
+    bool logarithmic = false; 
+    int count = num_bins; 
+    if(chosen) 
+        count = choose_bins(data, hist_opts, num_bins, &lo, &hi, 
+                            &logarithmic); 
+
+    double* totals = chosen ? calloc(count, sizeof(double)) : bins; 
+    double bin_width = (hi - lo) / count; 
+
+    size_t threads = plot_opts->threads; 
+    if(threads == 0) threads = sysconf(_SC_NPROCESSORS_ONLN); 
+    if(threads > data->size / MIN_SLICE_SIZE) 
+        threads = data->size / MIN_SLICE_SIZE; 
+    if(threads < 1) threads = 1; 
+
+    bin_slice* slices = malloc(threads * sizeof(bin_slice)); 
+    for(size_t i = 0; i < threads; i++) {
+        size_t start = data->size * i / threads; 
+        size_t stop = data->size * (i + 1) / threads; 
+        slices[i] = (bin_slice) { 
+            data->data + start, stop - start, lo, hi, bin_width, count, 
+            logarithmic, calloc(count + 1, sizeof(size_t)), 
+            digest ? create_tdigest(DIGEST_COMPRESSION) : NULL 
+        }; 
+    }
 
-        // if we're at exactly the maximum, put that in the
-        // right-most bin. 
-        if(x == plot_opts->x_max) bin -= 1; 
+    pthread_t* workers = malloc(threads * sizeof(pthread_t)); 
+    for(size_t i = 1; i < threads; i++) 
+        pthread_create(&workers[i], NULL, bin_values, &slices[i]); 
+    bin_values(&slices[0]); 
+    for(size_t i = 1; i < threads; i++) 
+        pthread_join(workers[i], NULL); 
+
+    // add up the counts (and digests) from every thread 
+    for(size_t i = 0; i < threads; i++) {
+        for(int bin = 0; bin < count; bin++) 
+            totals[bin] += slices[i].counts[bin]; 
+        free(slices[i].counts); 
+
+        if(digest != NULL) {
+            merge_digests(digest, slices[i].digest); 
+            delete_tdigest(slices[i].digest); 
+        }
+    }
+    free(workers); 
+    free(slices); 
+
+    // each chosen bin is drawn as a bar as high as its count, across 
+    // the plot's bins that it covers. where the chosen bins are the 
+    // narrower ones, each of the plot's bins is as high as the average 
+    // count of those it covers (or parts of them). the chosen bins span 
+    // the same range as the plot's, which is on a log scale for log 
+    // bins, so the plot's x axis is too. 
+    if(chosen) {
+        if(logarithmic) {
+            plot_opts->x_log = true; 
+            plot_opts->x_min = exp(lo); 
+        }
 
-        if(bin >= num_bins || bin < 0) continue; 
-        bins[bin] += 1; 
+        double plot_width = (hi - lo) / num_bins; 
+        if(count <= num_bins) {
+            for(int i = 0; i < num_bins; i++) {
+                int bin = (i + 0.5) * plot_width / bin_width; 
+                bins[i] = totals[bin < count ? bin : count - 1]; 
+            }
+        } else {
+            for(int i = 0; i < count; i++) {
+                double start = lo + i * bin_width; 
+                double end = i == count - 1 ? hi : start + bin_width; 
+                spread_count(start, end, totals[i], lo, hi, bins, 
+                             num_bins); 
+            }
+            for(int i = 0; i < num_bins; i++) 
+                bins[i] *= bin_width / plot_width; 
+        }
+        free(totals); 
     }
 
     // scale down for relative frequencies. 
-    if(relative) 
+    if(hist_opts->relative) 
         for(int i = 0; i < num_bins; i++) 
             bins[i] /= data->size; 
 
+    // the bars of chosen bins are only as high as the count of one of 
+    // them, so the y axis is rescaled to the highest bar (a column is 
+    // two of the plot's bins, side by side). 
+    if(chosen && plot_opts->rescale) {
+        plot_opts->y_max = 0; 
+        for(int i = 0; i < num_bins; i++) 
+            if(bins[i] > plot_opts->y_max) plot_opts->y_max = bins[i]; 
+        if(plot_opts->y_max == 0) plot_opts->y_max = 1; 
+    }
+
+    return bins; 
+}
+
+// chooses how many bins to sort the data into, and the range they 
+// cover, from lo to hi (which start out as the plot's range). on a log 
+// scale, they're the logs of the range, which starts at the smallest 
+// positive value instead (if that's above lo). unless there are no 
+// positive values or there's nothing left of the range, in which case 
+// the bins are spaced evenly after all. the rules are worked out on 
+// the same scale as the bins. 
+int choose_bins(value_list* data, hist_options* hist_opts, 
+                int screen_bins, double* lo, double* hi, 
+                bool* logarithmic) {
+    double smallest; 
+    size_t n = 0; 
+    *logarithmic = hist_opts->log_bins && *hi > 0; 
+    if(*logarithmic) {
+        n = partition_values(data, true, &smallest); 
+        if(*lo > smallest) smallest = *lo; 
+        if(n == 0 || smallest >= *hi) *logarithmic = false; 
+    }
+    if(!*logarithmic) 
+        n = partition_values(data, false, &smallest); 
+
+    if(*logarithmic) {
+        *lo = log(smallest); 
+        *hi = log(*hi); 
+    }
+
+    int bins = screen_bins; 
+    if(hist_opts->bin_rule == FIXED_BINS) bins = hist_opts->num_bins; 
+    if(hist_opts->bin_rule == SCREEN_BINS || 
+       hist_opts->bin_rule == FIXED_BINS || n == 0) 
+        return bins < MAX_CHOSEN_BINS ? bins : MAX_CHOSEN_BINS; 
+
+    // sturges' rule, which assumes the data is roughly normal 
+    int sturges = ceil(log2(n)) + 1; 
+    if(hist_opts->bin_rule == STURGES_BINS) return sturges; 
+
+    // the freedman-diaconis rule makes the bins 2 IQR / cbrt(n) wide, 
+    // which copes with heavy tails far better. the quartiles are 
+    // selected from the values in place, rather than sorting them. 
+    size_t ranks[2] = { (n - 1) / 4, 3 * (n - 1) / 4 }; 
+    double quartiles[2]; 
+    select_ranks(data->data, n, ranks, quartiles, 2); 
+    if(*logarithmic) {
+        quartiles[0] = log(quartiles[0]); 
+        quartiles[1] = log(quartiles[1]); 
+    }
+
+    double width = 2 * (quartiles[1] - quartiles[0]) / cbrt(n); 
+    double fd = width > 0 ? ceil((*hi - *lo) / width) : 0; 
+    if(fd > MAX_CHOSEN_BINS) fd = MAX_CHOSEN_BINS; 
+    if(fd < 1) fd = sturges; 
+
+    // the auto rule is whichever gives more bins 
+    if(hist_opts->bin_rule == FD_BINS || fd > sturges) return fd; 
+    return sturges; 
+}
+
+// moves the values the bins are chosen from (the finite ones, and only 
+// the positive ones if positive is set) to the start of the data, 
+// returning how many there are and setting smallest to the smallest of 
+// them. 
+size_t partition_values(value_list* data, bool positive, 
+                        double* smallest) {
+    double* v = data->data; 
+    size_t n = 0; 
+    *smallest = INFINITY; 
+
+    for(size_t i = 0; i < data->size; i++) {
+        double x = v[i]; 
+        if(!isfinite(x) || (positive && x <= 0)) continue; 
+
+        v[i] = v[n]; 
+        v[n++] = x; 
+        if(x < *smallest) *smallest = x; 
+    }
+
+    return n; 
+}
+
+// retrieves the same frequencies as get_freqs, but without storing 
+// the data: each value is added to a fixed number of adaptive bins as 
+// it's read, and those are resampled onto the plot's bins at the end. 
+double* stream_freqs(hist_options* hist_opts, tdigest* digest, 
+                     plot_options* plot_opts) {
+    adaptive_bins* b = read_into_bins(hist_opts->stream_bins, digest, 
+                                      plot_opts);  
+    double* bins = bins_to_freqs(b, hist_opts, plot_opts); 
+    delete_adaptive_bins(b); 
+    return bins; 
+}
+
+// reads every value from the data source into the given number of 
+// adaptive bins, and the digest if there is one. 
+adaptive_bins* read_into_bins(int num_bins, tdigest* digest, 
+                              plot_options* plot_opts) {
+    adaptive_bins* b = create_adaptive_bins(num_bins); 
+    reader* r = create_reader(plot_opts->data_input); 
+    double x; 
+    while(read_value(r, &x)) {
+        add_to_bins(b, x); 
+        if(digest != NULL) add_to_digest(digest, x); 
+    }
+    delete_reader(r); 
+    return b; 
+}
+
+// reads the partial histograms in the given files and adds them up. 
+// the first one keeps its bins, and the rest are merged into it. if 
+// there's a digest, the digests saved with them are merged into it. 
+// exits if any of them can't be read, or has no digest when one is 
+// wanted. 
+adaptive_bins* read_partials(char** paths, int num_paths, 
+                             tdigest* digest) {
+    if(num_paths == 0) {
+        fprintf(stderr, "histogram: --merge needs a partial histogram " 
+                "to merge\n"); 
+        exit(EXIT_FAILURE); 
+    }
+
+    adaptive_bins* b = NULL; 
+    for(int i = 0; i < num_paths; i++) {
+        tdigest* saved; 
+        adaptive_bins* other = read_bins(paths[i], &saved); 
+        if(other == NULL) exit(EXIT_FAILURE); 
+
+        if(digest != NULL) {
+            if(saved == NULL) {
+                fprintf(stderr, "%s: no quantiles were saved with this " 
+                        "partial histogram (write it with --quantiles)\n", 
+                        paths[i]); 
+                exit(EXIT_FAILURE); 
+            }
+            merge_digests(digest, saved); 
+        }
+        if(saved != NULL) delete_tdigest(saved); 
+
+        if(b == NULL) b = other; 
+        else {
+            merge_bins(b, other); 
+            delete_adaptive_bins(other); 
+        }
+    }
+
+    return b; 
+}
+
+// resamples adaptive bins onto the plot's bins, rescaling the plot to 
+// fit them first. 
+double* bins_to_freqs(adaptive_bins* b, hist_options* hist_opts, 
+                      plot_options* plot_opts) {
+    rescale_to_range(b->min, b->max, b->total, hist_opts, plot_opts); 
+
+    int num_bins = plot_opts->width * 2; 
+    double* bins = calloc(num_bins, sizeof(double)); 
+    resample_bins(b, plot_opts->x_min, plot_opts->x_max, bins, 
+                  num_bins); 
+
+    // scale down for relative frequencies. 
+    if(hist_opts->relative && b->total > 0) 
+        for(int i = 0; i < num_bins; i++) 
+            bins[i] /= b->total; 
+
     return bins; 
 }
 
+// draws the frequencies with full-width or half-width bars, as the 
+// histogram options say, and frees them. 
+const char** freqs_to_contents(double* bars, hist_options* hist_opts, 
+                               plot_options* plot_opts) {
+    const char** contents; 
+    if(hist_opts->full_width) 
+        contents = make_full_content(bars, plot_opts); 
+    else 
+        contents = make_half_content(bars, plot_opts); 
+
+    free(bars); 
+    return contents; 
+}
+
+// prints the estimated quantiles, and marks them on the plot with a 
+// dotted line through the empty cells of their columns. 
+void mark_quantiles(const char** contents, tdigest* digest, 
+                    plot_options* plot_opts) {
+    double x_min = plot_opts->x_min, x_max = plot_opts->x_max; 
+    if(plot_opts->x_log) {
+        x_min = log(x_min); 
+        x_max = log(x_max); 
+    }
+    double x_per_col = (x_max - x_min) / plot_opts->width; 
+
+    for(int i = 0; i < NUM_QUANTILES; i++) {
+        double x = digest_quantile(digest, QUANTILES[i]); 
+        printf("%sp%g = %g", i > 0 ? ", " : "", 100 * QUANTILES[i], x); 
+
+        if(!(x >= plot_opts->x_min && x <= plot_opts->x_max)) continue; 
+        if(plot_opts->x_log) x = log(x); 
+        int col = (x - x_min) / x_per_col; 
+        if(col >= plot_opts->width) col = plot_opts->width - 1; 
+
+        for(int row = 0; row < plot_opts->height; row++) {
+            int index = row * plot_opts->width + col; 
+            if(contents[index][0] == ' ') 
+                contents[index] = QUANTILE_MARKER; 
+        }
+    }
+    printf("\n"); 
+}
+
+// entry point for each of the threads binning the data. a value goes 
+// in bin (x - x_min) / bin_width (rounded towards 0), or the one before 
+// if it's exactly x_max, and any value whose bin is out of range goes 
+// in the extra bin instead. this is exactly the division get_freqs has 
+// always done, so values on the edge of a bin stay where they were. 
+void* bin_values(void* arg) {
+    // copied out of the slice, since otherwise they'd be reloaded 
+    // after every count in case the count had changed them 
+    bin_slice* s = arg; 
+    const double* values = s->values; 
+    size_t n = s->n; 
+    double x_min = s->x_min, x_max = s->x_max, width = s->bin_width; 
+    int num_bins = s->num_bins; 
+    bool logarithmic = s->logarithmic; 
+    size_t* counts = s->counts; 
+    tdigest* digest = s->digest; 
+
+    for(size_t i = 0; i < n; i++) {
+        double x = values[i]; 
+        if(digest != NULL) add_to_digest(digest, x); 
+
+        // values that aren't positive have no log, so no bin 
+        if(logarithmic) {
+            if(!(x > 0)) {
+                counts[num_bins]++; 
+                continue; 
+            }
+            x = log(x); 
+        }
+
+        int bin = (x - x_min) / width; 
+        if(x == x_max) bin -= 1; 
+        if(bin >= num_bins || bin < 0) bin = num_bins; 
+        counts[bin]++; 
+    }
+
+    return NULL; 
+}
+
 // creates a histogram out of the frequency data using full-width
 // bars. 
 const char** make_full_content(double* bins, 
@@ -14,10 +14,28 @@
 #define HISTOGRAM_H
 
 #include "hist_options.h"
+#include "list.h"
 #include "plot_options.h"
+#include "tdigest.h"
 
 // reads data from the provided input data source (in the plot 
 // options), then constructs the content of the plot. 
 const char** data_to_histogram(hist_options*, plot_options*); 
 
+// sorts the given data into two bins per column of the plot (or the 
+// bins the histogram options choose), adding it to the digest too if 
+// there is one, and returns their absolute or relative frequencies. 
+// the bins are filled by as many threads as the plot options say. 
+double* get_freqs(value_list*, hist_options*, tdigest*, plot_options*); 
+
+// bins data from the input data source (or merges the partial 
+// histograms in the given files, if the histogram options say so) and 
+// writes the bins to the partial histogram file in the options. 
+void write_partial(char**, int, hist_options*, plot_options*); 
+
+// adds up the partial histograms in the given files, then constructs 
+// the content of the plot. 
+const char** partials_to_histogram(char**, int, hist_options*, 
+                                   plot_options*); 
+
 #endif 
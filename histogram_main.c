@@ -7,9 +7,14 @@
 #include <stdio.h> 
 #include <stdlib.h>
 
+#define PARTIAL_FILE_KEY    ARGP_KEY_ARG 
+
 // helper struct that contains both the histogram options and the
-// plot options. 
+// plot options, as well as the partial histograms to merge (if there 
+// are any). 
 typedef struct all_options {
+    char** partials; 
+    int num_partials; 
     hist_options* hist_opts; 
     plot_options* plot_opts; 
 } all_options; 
@@ -21,6 +26,11 @@ error_t parse_params(int key, char* arg, struct argp_state* state) {
     state->child_inputs[0] = opts->plot_opts; 
     state->child_inputs[1] = opts->hist_opts; 
 
+    switch(key) {
+           case PARTIAL_FILE_KEY: 
+        opts->partials[opts->num_partials++] = arg; 
+    }
+
     return 0; 
 }
 
@@ -28,7 +38,8 @@ int main(int argc, char** argv) {
     // create default options for the histogram and plot 
     plot_options plot_opts = default_plot_options(); 
     hist_options hist_opts = default_hist_options(); 
-    all_options opts = { &hist_opts, &plot_opts }; 
+    char** partials = malloc(argc * sizeof(char*)); 
+    all_options opts = { partials, 0, &hist_opts, &plot_opts }; 
 
     // pass to the argp parser. 
     struct argp_child children[] = {
@@ -38,17 +49,49 @@ int main(int argc, char** argv) {
     }; 
 
     struct argp argp = {
-        0, parse_params, 0, 
-        "Creates a histogram out of the data provided. ", 
+        0, parse_params, "[PARTIAL...]", 
+        "Creates a histogram out of the data provided, or out of the " 
+        "partial histograms given with --merge. ", 
         children
     }; 
 
     argp_parse(&argp, argc, argv, 0, 0, &opts); 
 
+    if(opts.num_partials > 0 && !hist_opts.merge) {
+        fprintf(stderr, "histogram: partial histograms can only be " 
+                "given with --merge\n"); 
+        free(partials); 
+        return EXIT_FAILURE; 
+    }
+
+    if((hist_opts.bin_rule != SCREEN_BINS || hist_opts.log_bins) && 
+       (hist_opts.stream_bins || hist_opts.merge || 
+        hist_opts.partial != NULL)) {
+        fprintf(stderr, "histogram: --bins and --log-bins need the data " 
+                "itself, not streamed or partial histograms\n"); 
+        free(partials); 
+        return EXIT_FAILURE; 
+    }
+
+    // writing a partial histogram is a separate mode that doesn't 
+    // draw anything 
+    if(hist_opts.partial != NULL) {
+        write_partial(partials, opts.num_partials, &hist_opts, 
+                      &plot_opts); 
+        free(partials); 
+        return 0; 
+    }
+
     // Now actually do something with the options. 
-    const char** content = data_to_histogram(&hist_opts, &plot_opts);
+    const char** content; 
+    if(hist_opts.merge) 
+        content = partials_to_histogram(partials, opts.num_partials, 
+                                        &hist_opts, &plot_opts); 
+    else 
+        content = data_to_histogram(&hist_opts, &plot_opts); 
     draw_plot(content, &plot_opts); 
     free(content); 
+    free(partials); 
 
     return 0; 
 }
@@ -0,0 +1,228 @@
+/** 
+ *  Implementation file for interpolate.h
+ */ 
+
+#include "graph_options.h"
+#include "interpolate.h"
+#include "sort.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// when the points are already in memory, the spline is solved over 
+// all of them at once. streams that don't fit in memory are solved 
+// over a sliding window of knots instead, which is an approximation: 
+// cutting the system off at the edge of a window perturbs the nearby 
+// coefficients, and the perturbation shrinks by a factor of at least 
+// 1.5 per knot (about 3.7 for evenly spaced knots). a margin of 64 
+// knots makes it negligible for evenly spaced, randomly spaced and 
+// clustered knots (tests/interpolate_test.c), but not if the spacing 
+// grows steadily by many orders of magnitude within a margin: the 
+// second derivatives where the knots are close together are then 
+// large enough for what's left of the perturbation to matter where 
+// they're far apart. 
+#define SPLINE_WINDOW 4096
+#define SPLINE_MARGIN 64
+
+// helper struct for reading points out of a stream one step ahead. 
+typedef struct lookahead {
+    point_stream* data; 
+    double x, y;    // the next point from the stream 
+    bool more;      // false once the stream is exhausted
+} lookahead; 
+
+// forward declarations of helper functions 
+static void sweep_interp(bool, lookahead*, const double*, double*, 
+                         size_t); 
+static void spline_interp(lookahead*, const double*, double*, size_t);
+static bool next_knot(lookahead*, double*, double*); 
+static void solve_spline(const double*, const double*, double*, 
+                         double*, size_t); 
+static double eval_spline(const double*, const double*, const double*,
+                          size_t, double); 
+
+/** 
+ *  Interpolates the sorted points in the stream at each of the n 
+ *  (increasing) positions in xs. Returns false if there are no 
+ *  points in the stream. 
+ */ 
+bool interpolate(enum interpolant i, point_stream* data, 
+                 const double* xs, double* ys, size_t n) {
+    lookahead points = { data }; 
+    points.more = next_point(data, &points.x, &points.y); 
+    if(!points.more) return false; 
+
+    switch(i) {
+           case LINEAR: 
+        sweep_interp(true, &points, xs, ys, n); 
+    break; case STEP: 
+        sweep_interp(false, &points, xs, ys, n); 
+    break; case SPLINE: 
+        spline_interp(&points, xs, ys, n); 
+    }
+
+    return true; 
+}
+
+/** Implementations of helper functions **/ 
+// the sweep shared by the linear and step interpolants. at each 
+// sample, curr is the last point with curr.x <= x and next is the 
+// point after it (if there is one). 
+static void sweep_interp(bool linear, lookahead* points, 
+                         const double* xs, double* ys, size_t n) {
+    double curr_x = points->x, curr_y = points->y, next_x, next_y; 
+    double first_x = curr_x; 
+    bool more = next_point(points->data, &next_x, &next_y); 
+
+    for(size_t i = 0; i < n; i++) {
+        // if x is less than the first data point, set x to the 
+        // smallest x value and proceed per usual. 
+        double x = xs[i]; 
+        if(x < first_x) x = first_x; 
+
+        // now move along until curr.x <= x < next.x 
+        while(more && next_x <= x) {
+            curr_x = next_x; 
+            curr_y = next_y; 
+            more = next_point(points->data, &next_x, &next_y); 
+        }
+
+        // use the largest y-value if x is too large for our data, 
+        // otherwise perform the interpolation. 
+        if(!more || !linear) {
+            ys[i] = curr_y; 
+            continue; 
+        }
+
+        double slope = (next_y - curr_y) / (next_x - curr_x); 
+        ys[i] = (x - curr_x) * slope + curr_y; 
+    }
+}
+
+// the natural cubic spline. knots are read into a window, the spline
+// is solved over the whole window, and then only the samples in the 
+// middle of the window (at least SPLINE_MARGIN knots away from an 
+// artificial end) are evaluated. the window then slides forward, 
+// keeping enough knots to provide the margin on the other side. if 
+// the points are in memory, the window holds all of them, so there 
+// are no artificial ends and the spline is exact. 
+static void spline_interp(lookahead* points, const double* xs, 
+                          double* ys, size_t n) {
+    size_t capacity = SPLINE_WINDOW + 2 * SPLINE_MARGIN; 
+    if(points->data->memory != NULL && points->data->size >= capacity) 
+        capacity = points->data->size + 1; 
+    double* kx = malloc(capacity * sizeof(double)); 
+    double* ky = malloc(capacity * sizeof(double)); 
+    double* m = malloc(capacity * sizeof(double)); 
+    double* scratch = malloc(capacity * sizeof(double)); 
+
+    size_t size = 0, sample = 0; 
+    bool at_start = true; 
+
+    while(true) {
+        bool exhausted = false; 
+        while(size < capacity) {
+            if(!next_knot(points, &kx[size], &ky[size])) {
+                exhausted = true; 
+                break; 
+            }
+            size++; 
+        }
+
+        solve_spline(kx, ky, m, scratch, size); 
+
+        // the knots whose segments we trust in this window 
+        size_t lo = at_start ? 0 : SPLINE_MARGIN; 
+        size_t hi = exhausted ? size - 1 : size - 1 - SPLINE_MARGIN; 
+
+        for(size_t segment = lo; sample < n; sample++) {
+            double x = xs[sample]; 
+            if(at_start && x <= kx[0]) {
+                ys[sample] = ky[0]; 
+                continue; 
+            }
+
+            if(x >= kx[size - 1] && exhausted) {
+                ys[sample] = ky[size - 1]; 
+                continue; 
+            }
+
+            // past the trusted part of the window - slide it along 
+            if(x > kx[hi]) break; 
+
+            while(kx[segment + 1] < x) segment++; 
+            ys[sample] = eval_spline(kx, ky, m, segment, x); 
+        }
+
+        if(exhausted || sample == n) break; 
+
+        // keep the knots from hi - SPLINE_MARGIN onwards, so that hi
+        // is at the start of the next window's trusted part. 
+        size_t keep = hi - SPLINE_MARGIN; 
+        memmove(kx, kx + keep, (size - keep) * sizeof(double)); 
+        memmove(ky, ky + keep, (size - keep) * sizeof(double)); 
+        size -= keep; 
+        at_start = false; 
+    }
+
+    free(kx); 
+    free(ky); 
+    free(m); 
+    free(scratch); 
+}
+
+// reads the next knot from the stream. consecutive points with the 
+// same x-coordinate become a single knot at their mean y-coordinate.
+static bool next_knot(lookahead* points, double* x, double* y) {
+    if(!points->more) return false; 
+
+    *x = points->x; 
+    double sum = points->y; 
+    size_t count = 1; 
+    while((points->more = next_point(points->data, &points->x, 
+                                     &points->y)) && points->x == *x) {
+        sum += points->y; 
+        count++; 
+    }
+
+    *y = sum / count; 
+    return true; 
+}
+
+// solves for the second derivatives m of the natural cubic spline 
+// through the n knots (x, y), using the Thomas algorithm on the 
+// tridiagonal system. c is scratch space for n values. 
+static void solve_spline(const double* x, const double* y, double* m, 
+                         double* c, size_t n) {
+    m[0] = c[0] = 0; 
+    if(n < 3) {
+        if(n == 2) m[1] = 0; 
+        return; 
+    }
+
+    // forward elimination on rows 1 through n - 2 
+    for(size_t i = 1; i + 1 < n; i++) {
+        double h0 = x[i] - x[i - 1], h1 = x[i + 1] - x[i]; 
+        double d = (y[i + 1] - y[i]) / h1 - (y[i] - y[i - 1]) / h0; 
+        d *= 6; 
+        double denominator = 2 * (h0 + h1) - h0 * c[i - 1]; 
+
+        c[i] = h1 / denominator; 
+        m[i] = (d - h0 * m[i - 1]) / denominator; 
+    }
+
+    // back substitution 
+    m[n - 1] = 0; 
+    for(size_t i = n - 2; i > 0; i--) m[i] -= c[i] * m[i + 1]; 
+}
+
+// evaluates the spline on the segment between knots i and i + 1. 
+static double eval_spline(const double* x, const double* y, 
+                          const double* m, size_t i, double at) {
+    double h = x[i + 1] - x[i]; 
+    double a = (x[i + 1] - at) / h, b = (at - x[i]) / h; 
+    return a * y[i] + b * y[i + 1] + 
+           ((a * a * a - a) * m[i] + (b * b * b - b) * m[i + 1]) * 
+           h * h / 6; 
+}
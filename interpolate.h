@@ -0,0 +1,40 @@
+/** 
+ *  The interpolation engine used to turn sorted (x, y) data into the 
+ *  values of a graph at each of its column borders. Rather than 
+ *  searching the data separately for every sample, the data and the 
+ *  (increasing) sample positions are walked together in a single 
+ *  merge-style pass, so evaluating all of the samples costs 
+ *  O(n + samples) no matter which interpolant is used. 
+ * 
+ *  Three interpolants are supported: 
+ *   - LINEAR joins neighbouring points with straight lines. 
+ *   - STEP holds the value of the last point at or before x. 
+ *   - SPLINE is a natural cubic spline through the points. Points with
+ *     the same x-coordinate are merged into one with their mean y. 
+ *     Points in memory are solved as a single system; streams from an 
+ *     external sort are solved in overlapping windows, which is only 
+ *     an approximation (see interpolate.c). 
+ *  In every case, samples before the first point or after the last 
+ *  take the value of that point. 
+ */ 
+
+#ifndef INTERPOLATE_H
+#define INTERPOLATE_H
+
+#include "graph_options.h"
+#include "sort.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** 
+ *  Interpolates the points in the stream (which must be sorted) at 
+ *  each of the n positions in xs, storing the results in ys. The 
+ *  positions must be in increasing order. The stream is consumed in
+ *  a single pass and never held in memory all at once. Returns false 
+ *  (leaving ys untouched) if the stream has no points at all. 
+ */ 
+bool interpolate(enum interpolant i, point_stream* data, 
+                 const double* xs, double* ys, size_t n); 
+
+#endif 
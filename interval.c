@@ -0,0 +1,286 @@
+/**
+ *  Implementation file for interval.h
+ */
+
+#include "expression.h"
+#include "interval.h"
+
+#include <math.h>
+#include <stdbool.h>
+
+static const interval EMPTY = { INFINITY, -INFINITY };
+static const interval UNBOUNDED = { -INFINITY, INFINITY };
+
+// beyond this, the periods of the trig functions can't be located
+// accurately enough, so they're assumed to cover their whole range.
+#define MAX_TRIG_ARGUMENT 1e6
+
+// Forward declarations of helper functions.
+static bool is_empty(interval);
+static interval widen(interval);
+static interval add(interval, interval);
+static interval subtract(interval, interval);
+static interval multiply(interval, interval);
+static interval divide(interval, interval);
+static interval power(interval, interval);
+static interval integer_power(interval, double);
+static interval periodic(interval, double (*)(double), double, double);
+static interval tangent(interval);
+static interval logarithm(interval);
+static interval exponential(interval);
+static bool contains_period(interval, double, double);
+static double product(double, double);
+static void sample(expression*, double, interval*);
+static void subdivide(expression*, double, double, int, int, int,
+                      interval*);
+static double border(double, double, int, int);
+
+/**
+ *  Evaluates the expression over an interval of x, in the same way
+ *  that evaluate does for a single x.
+ */
+interval evaluate_interval(expression* e, interval x) {
+    expression* l = e->left;
+    expression* r = e->right;
+
+    switch(e->operation) {
+        case CONSTANT:  return (interval) { e->value, e->value };
+        case VARIABLE:  return x;
+        case PARAMETER: return (interval) { e->value, e->value };
+
+        case ADD:       return add(evaluate_interval(l, x),
+                                   evaluate_interval(r, x));
+        case SUBTRACT:  return subtract(evaluate_interval(l, x),
+                                        evaluate_interval(r, x));
+        case MULTIPLY:  return multiply(evaluate_interval(l, x),
+                                        evaluate_interval(r, x));
+        case DIVIDE:    return divide(evaluate_interval(l, x),
+                                      evaluate_interval(r, x));
+        case POWER:     return power(evaluate_interval(l, x),
+                                     evaluate_interval(r, x));
+        default:        break;
+    }
+
+    // everything else is a function of one argument
+    interval a = evaluate_interval(l, x);
+    interval one = { 1, 1 };
+    if(is_empty(a)) return EMPTY;
+
+    switch(e->operation) {
+        case SINE:      return periodic(a, sin, M_PI / 2, -M_PI / 2);
+        case COSINE:    return periodic(a, cos, 0, M_PI);
+        case TANGENT:   return tangent(a);
+
+        // cot is cos / sin rather than 1 / tan, which is unbounded
+        // wherever tan has an asymptote, even though cot is 0 there
+        case SECANT:    return divide(one, periodic(a, cos, 0, M_PI));
+        case COSECANT:  return divide(one, periodic(a, sin, M_PI / 2,
+                                                    -M_PI / 2));
+        case COTANGENT: return divide(periodic(a, cos, 0, M_PI),
+                                      periodic(a, sin, M_PI / 2,
+                                               -M_PI / 2));
+
+        // the inverse functions are monotonic on their domains
+        case ARCSIN:
+            if(a.hi < -1 || a.lo > 1) return EMPTY;
+            return widen((interval) { asin(fmax(a.lo, -1)),
+                                      asin(fmin(a.hi, 1)) });
+        case ARCCOS:
+            if(a.hi < -1 || a.lo > 1) return EMPTY;
+            return widen((interval) { acos(fmin(a.hi, 1)),
+                                      acos(fmax(a.lo, -1)) });
+        case ARCTAN:
+            return widen((interval) { atan(a.lo), atan(a.hi) });
+
+        case LOG:       return logarithm(a);
+        case EXP:       return exponential(a);
+        default:        return UNBOUNDED;
+    }
+}
+
+/**
+ *  Finds bounds on the values of the expression between x_min and
+ *  x_max. The domain is split in half repeatedly, but only where the
+ *  interval of values might reach beyond the bounds found so far, so
+ *  smooth expressions need few evaluations.
+ */
+bool bound_expression(expression* e, double x_min, double x_max,
+                      int pieces, double* y_min, double* y_max) {
+    interval known = EMPTY;
+    sample(e, x_min, &known);
+    sample(e, x_max, &known);
+    if(pieces > 0) subdivide(e, x_min, x_max, pieces, 0, pieces, &known);
+
+    if(is_empty(known)) return false;
+    *y_min = known.lo;
+    *y_max = known.hi;
+    return true;
+}
+
+/** Implementations of helper functions **/
+// checks whether an interval contains no values.
+static bool is_empty(interval a) {
+    return a.lo > a.hi;
+}
+
+// widens a computed interval by an ulp on each side, since the bounds
+// were rounded (possibly in the wrong direction). bounds that came out
+// as NaN (from inf - inf, for instance) could have been anything.
+static interval widen(interval a) {
+    if(isnan(a.lo)) a.lo = -INFINITY;
+    if(isnan(a.hi)) a.hi = INFINITY;
+    a.lo = nextafter(a.lo, -INFINITY);
+    a.hi = nextafter(a.hi, INFINITY);
+    return a;
+}
+
+// a + b
+static interval add(interval a, interval b) {
+    if(is_empty(a) || is_empty(b)) return EMPTY;
+    return widen((interval) { a.lo + b.lo, a.hi + b.hi });
+}
+
+// a - b
+static interval subtract(interval a, interval b) {
+    if(is_empty(a) || is_empty(b)) return EMPTY;
+    return widen((interval) { a.lo - b.hi, a.hi - b.lo });
+}
+
+// a * b, which is bounded by the products of the endpoints.
+static interval multiply(interval a, interval b) {
+    if(is_empty(a) || is_empty(b)) return EMPTY;
+
+    double p[4] = { product(a.lo, b.lo), product(a.lo, b.hi),
+                    product(a.hi, b.lo), product(a.hi, b.hi) };
+    interval c = { p[0], p[0] };
+    for(int i = 1; i < 4; i++) {
+        c.lo = fmin(c.lo, p[i]);
+        c.hi = fmax(c.hi, p[i]);
+    }
+    return widen(c);
+}
+
+// a / b. if b contains 0, there's an asymptote somewhere in it.
+static interval divide(interval a, interval b) {
+    if(is_empty(a) || is_empty(b)) return EMPTY;
+    if(b.lo <= 0 && b.hi >= 0) return UNBOUNDED;
+    return multiply(a, widen((interval) { 1 / b.hi, 1 / b.lo }));
+}
+
+// a ^ b. integer powers are handled separately, since they're defined
+// for negative bases. otherwise, negative bases are left out (pow only
+// has values for them at isolated points) and a ^ b is exp(b log a).
+static interval power(interval a, interval b) {
+    if(is_empty(a) || is_empty(b)) return EMPTY;
+
+    if(b.lo == b.hi && b.lo == floor(b.lo) && fabs(b.lo) < 0x1p53) {
+        if(b.lo == 0) return (interval) { 1, 1 };
+        interval p = integer_power(a, fabs(b.lo));
+        return b.lo > 0 ? p : divide((interval) { 1, 1 }, p);
+    }
+
+    if(a.hi < 0) return EMPTY;
+    a.lo = fmax(a.lo, 0);
+    return exponential(multiply(b, logarithm(a)));
+}
+
+// a ^ n for a positive integer n. odd powers are increasing, and even
+// powers decrease until 0 and increase after it.
+static interval integer_power(interval a, double n) {
+    double lo = pow(a.lo, n), hi = pow(a.hi, n);
+    if(fmod(n, 2) == 1 || a.lo >= 0) return widen((interval) { lo, hi });
+    if(a.hi <= 0) return widen((interval) { hi, lo });
+    return widen((interval) { 0, fmax(lo, hi) });
+}
+
+// sin or cos of a. within a period, the function is monotonic except
+// at its peak (where it's 1) and trough (where it's -1).
+static interval periodic(interval a, double (*f)(double), double peak,
+                         double trough) {
+    if(!(a.hi - a.lo < 2 * M_PI) || fabs(a.lo) > MAX_TRIG_ARGUMENT ||
+       fabs(a.hi) > MAX_TRIG_ARGUMENT) return (interval) { -1, 1 };
+
+    double lo = f(a.lo), hi = f(a.hi);
+    interval c = widen((interval) { fmin(lo, hi), fmax(lo, hi) });
+    if(contains_period(a, peak, 2 * M_PI)) c.hi = 1;
+    if(contains_period(a, trough, 2 * M_PI)) c.lo = -1;
+    return (interval) { fmax(c.lo, -1), fmin(c.hi, 1) };
+}
+
+// tan a, which increases between its asymptotes at pi/2 + k pi.
+static interval tangent(interval a) {
+    if(!(a.hi - a.lo < M_PI) || fabs(a.lo) > MAX_TRIG_ARGUMENT ||
+       fabs(a.hi) > MAX_TRIG_ARGUMENT ||
+       contains_period(a, M_PI / 2, M_PI)) return UNBOUNDED;
+    return widen((interval) { tan(a.lo), tan(a.hi) });
+}
+
+// log a, which is only defined for a >= 0.
+static interval logarithm(interval a) {
+    if(is_empty(a) || a.hi < 0) return EMPTY;
+    double lo = a.lo > 0 ? log(a.lo) : -INFINITY;
+    return widen((interval) { lo, log(a.hi) });
+}
+
+// exp a, which is increasing.
+static interval exponential(interval a) {
+    if(is_empty(a)) return EMPTY;
+    return widen((interval) { exp(a.lo), exp(a.hi) });
+}
+
+// checks whether the interval contains x + k * period for some integer
+// k. the test is made slightly generous, since neither x nor period is
+// exact.
+static bool contains_period(interval a, double x, double period) {
+    double slack = 1e-12 * (1 + fabs(a.lo) + fabs(a.hi));
+    double k = ceil((a.lo - slack - x) / period);
+    return x + k * period <= a.hi + slack;
+}
+
+// a * b, except that 0 * inf is 0 rather than NaN. the infinity stands
+// for a bound that's arbitrarily large, so the product is still 0.
+static double product(double a, double b) {
+    return a == 0 || b == 0 ? 0 : a * b;
+}
+
+// evaluates the expression at a single point, adding the value to the
+// known range if there is one.
+static void sample(expression* e, double x, interval* known) {
+    double y = evaluate(e, x);
+    if(!isfinite(y)) return;
+    if(y < known->lo) known->lo = y;
+    if(y > known->hi) known->hi = y;
+}
+
+// the left border of the given piece of [x_min, x_max].
+static double border(double x_min, double x_max, int pieces, int i) {
+    if(i == pieces) return x_max;
+    return x_min + (x_max - x_min) * i / pieces;
+}
+
+// extends the known range to cover the values over the pieces from
+// first up to (but not including) last. if the interval of values over
+// them lies within the known range, then there's nothing to do.
+// otherwise they're split in half, down to single pieces, which are
+// accepted as they are unless they're unbounded, in which case there's
+// an asymptote and the piece is left out.
+static void subdivide(expression* e, double x_min, double x_max,
+                      int pieces, int first, int last, interval* known) {
+    interval x = { border(x_min, x_max, pieces, first),
+                   border(x_min, x_max, pieces, last) };
+    interval y = evaluate_interval(e, x);
+    if(is_empty(y) || (y.lo >= known->lo && y.hi <= known->hi)) return;
+
+    if(last - first == 1) {
+        if(isfinite(y.lo) && isfinite(y.hi)) {
+            known->lo = fmin(known->lo, y.lo);
+            known->hi = fmax(known->hi, y.hi);
+        }
+        return;
+    }
+
+    int middle = first + (last - first) / 2;
+    sample(e, border(x_min, x_max, pieces, middle), known);
+    subdivide(e, x_min, x_max, pieces, first, middle, known);
+    subdivide(e, x_min, x_max, pieces, middle, last, known);
+}
@@ -0,0 +1,41 @@
+/**
+ *  Interval arithmetic for expressions. Rather than computing f(x) at
+ *  a single x, an expression is evaluated over a whole interval of x
+ *  values, giving an interval that's guaranteed to contain f(x) for
+ *  every x in it (though it may be wider than necessary). This lets
+ *  the range of an expression be found with few evaluations, since
+ *  pieces of the domain that can't extend the range are ruled out
+ *  without looking at them any closer.
+ */
+
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+#include "expression.h"
+
+#include <stdbool.h>
+
+// a closed interval of values. an interval with lo > hi is empty, and
+// the bounds may be infinite.
+typedef struct interval {
+    double lo, hi;
+} interval;
+
+/**
+ *  Evaluates the expression over an interval of x. Values where the
+ *  expression isn't defined (like the log of a negative number) are
+ *  left out, so the result is empty if it isn't defined anywhere.
+ */
+interval evaluate_interval(expression* e, interval x);
+
+/**
+ *  Finds bounds on the values of the expression for x between x_min
+ *  and x_max, which is treated as the given number of equal pieces
+ *  (e.g. the columns of a plot). Pieces where the values are still
+ *  unbounded contain an asymptote (like tan x at pi/2), and are left
+ *  out. Returns false if there are no values to bound.
+ */
+bool bound_expression(expression* e, double x_min, double x_max,
+                      int pieces, double* y_min, double* y_max);
+
+#endif
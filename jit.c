@@ -0,0 +1,248 @@
+/**
+ *  Implementation file for jit.h
+ */
+
+#include "jit.h"
+#include "program.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+
+// machine code is assembled into a growable buffer, then copied into
+// an executable mapping once it's complete.
+typedef struct code_buffer {
+    unsigned char* bytes;
+    size_t size, capacity;
+} code_buffer;
+
+// the libm function called for each of the unary opcodes, and whether
+// the result should then be inverted (e.g. sec x = 1 / cos x).
+static const struct unary_call {
+    double (*function)(double);
+    bool reciprocal;
+} UNARY_CALLS[] = {
+    [OP_SINE] = {sin, false},       [OP_COSINE] = {cos, false},
+    [OP_TANGENT] = {tan, false},    [OP_SECANT] = {cos, true},
+    [OP_COSECANT] = {sin, true},    [OP_COTANGENT] = {tan, true},
+    [OP_ARCSIN] = {asin, false},    [OP_ARCCOS] = {acos, false},
+    [OP_ARCTAN] = {atan, false},
+    [OP_LOG] = {log, false},        [OP_EXP] = {exp, false}
+};
+
+// the instruction for each of the arithmetic opcodes, applied to the
+// left operand in xmm0 and the right one in xmm1.
+static const char* ARITHMETIC[] = {
+    [OP_ADD] = "\xF2\x0F\x58\xC1",         // addsd xmm0, xmm1
+    [OP_MULTIPLY] = "\xF2\x0F\x59\xC1",    // mulsd xmm0, xmm1
+    [OP_SUBTRACT] = "\xF2\x0F\x5C\xC1",    // subsd xmm0, xmm1
+    [OP_DIVIDE] = "\xF2\x0F\x5E\xC1"       // divsd xmm0, xmm1
+};
+
+// Forward declarations of helper functions.
+static void put(code_buffer*, const char*, size_t);
+static void put32(code_buffer*, uint32_t);
+static void put64(code_buffer*, uint64_t);
+static void load_slot(code_buffer*, int32_t);
+static void store_slot(code_buffer*, int32_t);
+static void load_constant(code_buffer*, double);
+static void load_address(code_buffer*, const double*);
+static void call(code_buffer*, void*);
+static int32_t slot(size_t);
+
+/**
+ *  Translates a program into native code. The generated function
+ *  keeps the top of the stack in xmm0 and the rest of it in slots
+ *  on the machine stack, with x itself stored in the first slot.
+ */
+jit* compile_jit(program* p) {
+    if(p->num_outputs != 1) return NULL;
+    code_buffer b = { NULL, 0, 0 };
+
+    // the frame holds x, the program's stack and its slots, and keeps
+    // rsp 16-byte aligned for calls (it's 8 off on entry, due to the
+    // return address).
+    uint32_t frame = 8 * (p->max_depth + p->num_slots + 1);
+    if(frame % 16 == 0) frame += 8;
+
+    put(&b, "\x48\x81\xEC", 3);                 // sub rsp, frame
+    put32(&b, frame);
+    store_slot(&b, 0);                          // x goes in slot 0
+
+    size_t depth = 0;
+    for(size_t i = 0; i < p->size; i++) {
+        instruction* in = &p->code[i];
+
+        switch(in->op) {
+            // pushing values: spill the old top of the stack first
+            case OP_CONSTANT:
+                if(depth > 0) store_slot(&b, slot(depth - 1));
+                load_constant(&b, in->value);
+                depth++;
+                break;
+            case OP_VARIABLE:
+                if(depth > 0) store_slot(&b, slot(depth - 1));
+                load_slot(&b, 0);
+                depth++;
+                break;
+            case OP_PARAMETER:
+                if(depth > 0) store_slot(&b, slot(depth - 1));
+                load_address(&b, p->parameters[in->slot]);
+                depth++;
+                break;
+
+            // binary operators: the right operand is in xmm0, so move
+            // it to xmm1 and bring the left one back from memory.
+            case OP_ADD: case OP_SUBTRACT:
+            case OP_MULTIPLY: case OP_DIVIDE: case OP_POWER:
+                put(&b, "\x66\x0F\x28\xC8", 4);     // movapd xmm1, xmm0
+                load_slot(&b, slot(depth - 2));
+                depth--;
+
+                if(in->op == OP_POWER) call(&b, (void*) pow);
+                else put(&b, ARITHMETIC[in->op], 4);
+                break;
+
+            // slots come after the stack in the frame
+            case OP_STORE:
+                store_slot(&b, slot(p->max_depth + in->slot));
+                break;
+            case OP_LOAD:
+                if(depth > 0) store_slot(&b, slot(depth - 1));
+                load_slot(&b, slot(p->max_depth + in->slot));
+                depth++;
+                break;
+
+            // functions take their argument in xmm0 and return there
+            default:
+                call(&b, (void*) UNARY_CALLS[in->op].function);
+                if(UNARY_CALLS[in->op].reciprocal) {
+                    put(&b, "\x66\x0F\x28\xC8", 4);
+                    load_constant(&b, 1.0);
+                    put(&b, ARITHMETIC[OP_DIVIDE], 4);
+                }
+        }
+    }
+
+    put(&b, "\x48\x81\xC4", 3);                 // add rsp, frame
+    put32(&b, frame);
+    put(&b, "\xC3", 1);                         // ret
+
+    // copy the code into its own mapping, which is made executable
+    // (and read-only) once the code is in place.
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t length = (b.size + page - 1) / page * page;
+    void* code = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(code == MAP_FAILED) {
+        free(b.bytes);
+        return NULL;
+    }
+
+    memcpy(code, b.bytes, b.size);
+    free(b.bytes);
+    if(mprotect(code, length, PROT_READ | PROT_EXEC) != 0) {
+        munmap(code, length);
+        return NULL;
+    }
+
+    jit* j = malloc(sizeof(jit));
+    j->code = code;
+    j->length = length;
+    j->function = (jit_function) code;
+    return j;
+}
+
+/**
+ *  Unmaps and frees native code created by compile_jit.
+ */
+void delete_jit(jit* j) {
+    munmap(j->code, j->length);
+    free(j);
+}
+
+/** Implementations of helper functions **/
+// appends raw bytes to the buffer, growing it if needed.
+static void put(code_buffer* b, const char* bytes, size_t n) {
+    if(b->size + n > b->capacity) {
+        b->capacity = b->capacity ? 2 * b->capacity + n : 256;
+        b->bytes = realloc(b->bytes, b->capacity);
+    }
+
+    memcpy(b->bytes + b->size, bytes, n);
+    b->size += n;
+}
+
+// appends a little-endian 32-bit value.
+static void put32(code_buffer* b, uint32_t value) {
+    put(b, (const char*) &value, 4);
+}
+
+// appends a little-endian 64-bit value.
+static void put64(code_buffer* b, uint64_t value) {
+    put(b, (const char*) &value, 8);
+}
+
+// the offset from rsp of the slot holding the given stack level. x
+// lives in the slot at offset 0, just below the stack.
+static int32_t slot(size_t level) {
+    return 8 * (level + 1);
+}
+
+// movsd xmm0, [rsp + offset]
+static void load_slot(code_buffer* b, int32_t offset) {
+    put(b, "\xF2\x0F\x10\x84\x24", 5);
+    put32(b, offset);
+}
+
+// movsd [rsp + offset], xmm0
+static void store_slot(code_buffer* b, int32_t offset) {
+    put(b, "\xF2\x0F\x11\x84\x24", 5);
+    put32(b, offset);
+}
+
+// mov rax, <bits of value>; movq xmm0, rax
+static void load_constant(code_buffer* b, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put(b, "\x48\xB8", 2);
+    put64(b, bits);
+    put(b, "\x66\x48\x0F\x6E\xC0", 5);
+}
+
+// mov rax, <address>; movsd xmm0, [rax]
+static void load_address(code_buffer* b, const double* address) {
+    put(b, "\x48\xB8", 2);
+    put64(b, (uint64_t) address);
+    put(b, "\xF2\x0F\x10\x00", 4);
+}
+
+// mov rax, <address>; call rax
+static void call(code_buffer* b, void* function) {
+    put(b, "\x48\xB8", 2);
+    put64(b, (uint64_t) function);
+    put(b, "\xFF\xD0", 2);
+}
+
+#else
+
+/**
+ *  There's no code generator for this architecture.
+ */
+jit* compile_jit(program* p) {
+    return NULL;
+}
+
+/**
+ *  Nothing to free, since compile_jit never succeeds.
+ */
+void delete_jit(jit* j) {
+}
+
+#endif
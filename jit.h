@@ -0,0 +1,40 @@
+/**
+ *  A small just-in-time compiler for expressions. A compiled program
+ *  (see program.h) is translated into x86-64 machine code using SSE2,
+ *  which is written into its own executable page. The top of the
+ *  program's stack lives in a register and the rest of it in memory,
+ *  and functions like sin are calls into libm, so the native code
+ *  computes exactly the same values as run_program.
+ *
+ *  JIT compilation is only available on x86-64, and only where the
+ *  system allows executable memory to be mapped, for programs with a
+ *  single output; callers should fall back to run_program otherwise.
+ */
+
+#ifndef JIT_H
+#define JIT_H
+
+#include "program.h"
+
+#include <stddef.h>
+
+typedef double (*jit_function)(double);
+
+typedef struct jit {
+    void* code;                 // the mapped page(s) of machine code
+    size_t length;
+    jit_function function;      // entry point: x in, f(x) out
+} jit;
+
+/**
+ *  Translates a program into native code. Returns NULL if that isn't
+ *  possible on this machine, or if the program has several outputs.
+ */
+jit* compile_jit(program* p);
+
+/**
+ *  Unmaps and frees native code created by compile_jit.
+ */
+void delete_jit(jit* j);
+
+#endif
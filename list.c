@@ -81,3 +81,75 @@ void insert_sorted_list(list* l, void* item,
     // item belongs at the very front. 
     l->data[0] = item; 
 } 
+
+/** 
+ *  Creates an empty list of values, with a default capacity of 8. 
+ */ 
+value_list* create_value_list() {
+    value_list* l = (value_list*) malloc(sizeof(value_list)); 
+
+    l->capacity = 8; 
+    l->size = 0; 
+    l->data = (double*) malloc(8 * sizeof(double)); 
+    return l; 
+} 
+
+/** 
+ *  Destroys a value list allocated by create_value_list. 
+ */ 
+void delete_value_list(value_list* l) {
+    free(l->data); 
+    free(l); 
+} 
+
+/** 
+ *  Adds a value at the end of the list, doubling the capacity if it 
+ *  would not fit. 
+ */ 
+void append_value_list(value_list* l, double value) {
+    if(l->size >= l->capacity) {
+        l->capacity *= 2; 
+        l->data = (double*) realloc(l->data, 
+                                    l->capacity * sizeof(double)); 
+    }
+
+    l->data[ l->size ++ ] = value; 
+} 
+
+/** 
+ *  Creates an empty list of points, with a default capacity of 8. 
+ */ 
+point_list* create_point_list() {
+    point_list* l = (point_list*) malloc(sizeof(point_list)); 
+
+    l->capacity = 8; 
+    l->size = 0; 
+    l->x = (double*) malloc(8 * sizeof(double)); 
+    l->y = (double*) malloc(8 * sizeof(double)); 
+    return l; 
+} 
+
+/** 
+ *  Destroys a point list allocated by create_point_list. 
+ */ 
+void delete_point_list(point_list* l) {
+    free(l->x); 
+    free(l->y); 
+    free(l); 
+} 
+
+/** 
+ *  Adds the point (x, y) at the end of the list, doubling the 
+ *  capacity if it would not fit. 
+ */ 
+void append_point_list(point_list* l, double x, double y) {
+    if(l->size >= l->capacity) {
+        l->capacity *= 2; 
+        l->x = (double*) realloc(l->x, l->capacity * sizeof(double)); 
+        l->y = (double*) realloc(l->y, l->capacity * sizeof(double)); 
+    }
+
+    l->x[l->size] = x; 
+    l->y[l->size] = y; 
+    l->size++; 
+} 
@@ -3,6 +3,11 @@
  *  insertion, deletion, etc. functions; see below for a full list. 
  *  To support flexibility, the list stores void* pointers rather than
  *  actual values; the user is responsible for managing the typing. 
+ * 
+ *  For bulk numerical data, where a separately allocated element per
+ *  value would waste memory and scatter it across the heap, there are
+ *  also two typed variants: a value_list of doubles, and a point_list
+ *  that stores (x, y) pairs as two parallel arrays. 
  */ 
 
 #ifndef LIST_H
@@ -45,4 +50,46 @@ void append_list(list* l, void* item);
 void insert_sorted_list(list* l, void* item, 
                         int (*compare)(const void*, const void*)); 
 
+typedef struct value_list {
+    size_t capacity, size; 
+    double* data; 
+} value_list; 
+
+/** 
+ *  Creates an empty list of values, with a default capacity of 8. 
+ */ 
+value_list* create_value_list(); 
+
+/** 
+ *  Destroys a value list allocated by create_value_list. 
+ */ 
+void delete_value_list(value_list* l); 
+
+/** 
+ *  Adds a value at the end of the list, doubling the capacity if it 
+ *  would not fit. 
+ */ 
+void append_value_list(value_list* l, double value); 
+
+typedef struct point_list {
+    size_t capacity, size; 
+    double* x, * y; // the coordinates of point i are (x[i], y[i]) 
+} point_list; 
+
+/** 
+ *  Creates an empty list of points, with a default capacity of 8. 
+ */ 
+point_list* create_point_list(); 
+
+/** 
+ *  Destroys a point list allocated by create_point_list. 
+ */ 
+void delete_point_list(point_list* l); 
+
+/** 
+ *  Adds the point (x, y) at the end of the list, doubling the 
+ *  capacity if it would not fit. 
+ */ 
+void append_point_list(point_list* l, double x, double y); 
+
 #endif
@@ -0,0 +1,366 @@
+/**
+ *  Implementation file for optimize.h
+ */
+
+#include "expression.h"
+#include "optimize.h"
+#include "program.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// a node in the graph. nodes refer to their children by index, and
+// leaves have no children (-1).
+typedef struct dag_node {
+    enum opcode op;
+    int left, right;
+    double value;       // for OP_CONSTANT
+
+    size_t uses;        // number of distinct parents
+    bool emitted;       // whether the node's value is in its slot yet
+    size_t slot;
+} dag_node;
+
+// the graph itself, together with a hash table (using open addressing
+// and linear probing) of the nodes so that duplicates can be found.
+typedef struct dag {
+    dag_node* nodes;
+    size_t size, capacity;
+
+    int* table;         // node indices, or -1 for an empty bucket
+    size_t table_size;  // always a power of two
+
+    // whether parameters are read at run time rather than folded, and
+    // where from. an OP_PARAMETER node's value is its index in here.
+    bool live_parameters;
+    const double** parameters;
+    size_t num_parameters;
+} dag;
+
+// Forward declarations of helper functions.
+static int add_node(dag*, enum opcode, int, int, double);
+static int constant(dag*, double);
+static program* optimize(expression**, int, bool);
+static int build(dag*, expression*);
+static int parameter(dag*, expression*);
+static int power(dag*, int, long);
+static double fold(enum opcode, double, double);
+static size_t hash_node(enum opcode, int, int, double);
+static bool same_node(dag_node*, enum opcode, int, int, double);
+static void grow_table(dag*);
+static void count_uses(dag*, int);
+static size_t emit_node(dag*, int, program*, size_t*);
+static void push(program*, size_t*, instruction);
+
+/**
+ *  Compiles an expression tree into an optimised program, by way of
+ *  a graph of its distinct subexpressions.
+ */
+program* optimize_expression(expression* e) {
+    return optimize(&e, 1, false);
+}
+
+/**
+ *  Compiles an expression tree into an optimised program that reads
+ *  the values of its parameters when it runs.
+ */
+program* optimize_with_parameters(expression* e) {
+    return optimize(&e, 1, true);
+}
+
+/**
+ *  Compiles several expressions into one program, by way of a graph
+ *  of the distinct subexpressions of all of them. Their values are
+ *  left on the stack one after the other.
+ */
+program* optimize_expressions(expression** roots, int n) {
+    return optimize(roots, n, false);
+}
+
+/** Implementations of helper functions **/
+// compiles the expressions into one program, by way of the graph of
+// their distinct subexpressions.
+static program* optimize(expression** roots, int n, bool live) {
+    dag d = { NULL, 0, 0, NULL, 0, live, NULL, 0 };
+    grow_table(&d);
+    int* nodes = malloc(n * sizeof(int));
+    for(int i = 0; i < n; i++) {
+        nodes[i] = build(&d, roots[i]);
+        count_uses(&d, nodes[i]);
+    }
+
+    program* p = malloc(sizeof(program));
+    p->size = 0;
+    p->max_depth = 0;
+    p->num_slots = 0;
+    p->num_outputs = n;
+    p->code = NULL;
+    p->parameters = d.parameters;
+    p->num_parameters = d.num_parameters;
+
+    // each output is computed on top of the ones before it
+    size_t capacity = 0;
+    for(int i = 0; i < n; i++) {
+        size_t depth = i + emit_node(&d, nodes[i], p, &capacity);
+        if(depth > p->max_depth) p->max_depth = depth;
+    }
+
+    free(nodes);
+    free(d.nodes);
+    free(d.table);
+    return p;
+}
+
+// returns the node for the operation applied to the given children,
+// creating it unless an identical node already exists. if all of the
+// children are constants, the result is folded into a constant too.
+static int add_node(dag* d, enum opcode op, int left, int right,
+                    double value) {
+    bool leaf = op == OP_CONSTANT || op == OP_VARIABLE ||
+                op == OP_PARAMETER;
+    if(!leaf && d->nodes[left].op == OP_CONSTANT &&
+       (right < 0 || d->nodes[right].op == OP_CONSTANT)) {
+        double r = right < 0 ? 0 : d->nodes[right].value;
+        return add_node(d, OP_CONSTANT, -1, -1,
+                        fold(op, d->nodes[left].value, r));
+    }
+
+    // c1 * (c2 * e) becomes (c1 * c2) * e, since expressions like
+    // 2 * 3 * x are grouped as 2 * (3 * x). this can change the last
+    // bit of the result.
+    if(op == OP_MULTIPLY) {
+        int c = d->nodes[left].op == OP_CONSTANT ? left : right;
+        int other = c == left ? right : left;
+        dag_node* o = &d->nodes[other];
+
+        if(d->nodes[c].op == OP_CONSTANT && o->op == OP_MULTIPLY &&
+           (d->nodes[o->left].op == OP_CONSTANT ||
+            d->nodes[o->right].op == OP_CONSTANT)) {
+            int c2 = d->nodes[o->left].op == OP_CONSTANT ? o->left
+                                                          : o->right;
+            int e = c2 == o->left ? o->right : o->left;
+            double product = d->nodes[c].value * d->nodes[c2].value;
+            return add_node(d, OP_MULTIPLY, constant(d, product), e, 0);
+        }
+    }
+
+    // a + b and b + a are the same (as are a * b and b * a)
+    if((op == OP_ADD || op == OP_MULTIPLY) && left > right) {
+        int temp = left;
+        left = right;
+        right = temp;
+    }
+
+    size_t mask = d->table_size - 1;
+    size_t i = hash_node(op, left, right, value) & mask;
+    for(; d->table[i] >= 0; i = (i + 1) & mask) {
+        if(same_node(&d->nodes[d->table[i]], op, left, right, value))
+            return d->table[i];
+    }
+
+    if(d->size == d->capacity) {
+        d->capacity = d->capacity ? 2 * d->capacity : 64;
+        d->nodes = realloc(d->nodes, d->capacity * sizeof(dag_node));
+    }
+
+    d->nodes[d->size] = (dag_node) { op, left, right, value,
+                                     0, false, 0 };
+    d->table[i] = d->size;
+    if(2 * ++d->size > d->table_size) grow_table(d);
+    return d->size - 1;
+}
+
+// returns the node for a constant.
+static int constant(dag* d, double value) {
+    return add_node(d, OP_CONSTANT, -1, -1, value);
+}
+
+// adds the nodes for an expression tree to the graph and returns the
+// root. this is where the rewriting happens.
+static int build(dag* d, expression* e) {
+    int left = -1, right = -1;
+    if(e->left != NULL) left = build(d, e->left);
+    if(e->right != NULL) right = build(d, e->right);
+
+    switch(e->operation) {
+        case CONSTANT: return constant(d, e->value);
+        case PARAMETER:
+            if(d->live_parameters) return parameter(d, e);
+            return constant(d, e->value);
+        case VARIABLE: return add_node(d, OP_VARIABLE, -1, -1, 0);
+
+        // integer powers of something that varies are multiplied out
+        case POWER:
+            if(d->nodes[left].op != OP_CONSTANT &&
+               d->nodes[right].op == OP_CONSTANT) {
+                double n = d->nodes[right].value;
+                if(n == floor(n) && fabs(n) <= MAX_UNROLLED_POWER)
+                    return power(d, left, n);
+            }
+            return add_node(d, OP_POWER, left, right, 0);
+
+        // reciprocal trig functions
+        case SECANT:
+            return add_node(d, OP_DIVIDE, constant(d, 1),
+                            add_node(d, OP_COSINE, left, -1, 0), 0);
+        case COSECANT:
+            return add_node(d, OP_DIVIDE, constant(d, 1),
+                            add_node(d, OP_SINE, left, -1, 0), 0);
+        case COTANGENT:
+            return add_node(d, OP_DIVIDE, constant(d, 1),
+                            add_node(d, OP_TANGENT, left, -1, 0), 0);
+
+        default:
+            return add_node(d, OPCODES[e->operation], left, right, 0);
+    }
+}
+
+// returns the node for a parameter that's read at run time. each
+// parameter is a single node of the tree, so its address identifies it.
+static int parameter(dag* d, expression* e) {
+    size_t i = 0;
+    while(i < d->num_parameters && d->parameters[i] != &e->value) i++;
+    if(i == d->num_parameters) {
+        d->parameters = realloc(d->parameters,
+                                ++d->num_parameters * sizeof(double*));
+        d->parameters[i] = &e->value;
+    }
+
+    return add_node(d, OP_PARAMETER, -1, -1, i);
+}
+
+// builds base^n for an integer n by repeated squaring. negative
+// powers are the reciprocal of the positive power.
+static int power(dag* d, int base, long n) {
+    if(n == 0) return constant(d, 1);
+
+    int result = -1, square = base;
+    for(long m = labs(n); m > 0; m >>= 1) {
+        if(m & 1) result = result < 0 ? square
+                         : add_node(d, OP_MULTIPLY, result, square, 0);
+        if(m > 1) square = add_node(d, OP_MULTIPLY, square, square, 0);
+    }
+
+    if(n < 0)
+        result = add_node(d, OP_DIVIDE, constant(d, 1), result, 0);
+    return result;
+}
+
+// applies an operation to constant operands, exactly as run_program
+// would.
+static double fold(enum opcode op, double l, double r) {
+    switch(op) {
+        case OP_ADD:        return l + r;
+        case OP_SUBTRACT:   return l - r;
+        case OP_MULTIPLY:   return l * r;
+        case OP_DIVIDE:     return l / r;
+        case OP_POWER:      return pow(l, r);
+
+        case OP_SINE:       return sin(l);
+        case OP_COSINE:     return cos(l);
+        case OP_TANGENT:    return tan(l);
+        case OP_SECANT:     return 1.0 / cos(l);
+        case OP_COSECANT:   return 1.0 / sin(l);
+        case OP_COTANGENT:  return 1.0 / tan(l);
+
+        case OP_ARCSIN:     return asin(l);
+        case OP_ARCCOS:     return acos(l);
+        case OP_ARCTAN:     return atan(l);
+
+        case OP_LOG:        return log(l);
+        case OP_EXP:        return exp(l);
+        default:            return 0;
+    }
+}
+
+// hashes the contents of a node. constants are hashed (and compared)
+// by their bits, so that 0 and -0 stay apart.
+static size_t hash_node(enum opcode op, int left, int right,
+                        double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint64_t h = op;
+    h = h * 0x9E3779B97F4A7C15 + (uint32_t) left;
+    h = h * 0x9E3779B97F4A7C15 + (uint32_t) right;
+    h = h * 0x9E3779B97F4A7C15 + bits;
+    return h ^ (h >> 29);
+}
+
+// checks whether a node has the given contents.
+static bool same_node(dag_node* n, enum opcode op, int left, int right,
+                      double value) {
+    return n->op == op && n->left == left && n->right == right &&
+           memcmp(&n->value, &value, sizeof(value)) == 0;
+}
+
+// doubles the size of the hash table (or creates it) and reinserts
+// all of the nodes.
+static void grow_table(dag* d) {
+    d->table_size = d->table_size ? 2 * d->table_size : 128;
+    d->table = realloc(d->table, d->table_size * sizeof(int));
+    memset(d->table, -1, d->table_size * sizeof(int));
+
+    size_t mask = d->table_size - 1;
+    for(size_t j = 0; j < d->size; j++) {
+        dag_node* n = &d->nodes[j];
+        size_t i = hash_node(n->op, n->left, n->right, n->value) & mask;
+        while(d->table[i] >= 0) i = (i + 1) & mask;
+        d->table[i] = j;
+    }
+}
+
+// counts the number of parents of every node reachable from the given
+// one. a node that's reached for the first time passes the count on
+// to its children.
+static void count_uses(dag* d, int node) {
+    dag_node* n = &d->nodes[node];
+    if(n->uses++ > 0) return;
+    if(n->left >= 0) count_uses(d, n->left);
+    if(n->right >= 0) count_uses(d, n->right);
+}
+
+// appends the instructions for a node to the program, children first,
+// and returns the stack depth needed to run them. the first time a
+// shared node is computed it's stored in a slot, and afterwards it's
+// loaded from there.
+static size_t emit_node(dag* d, int node, program* p, size_t* capacity) {
+    dag_node* n = &d->nodes[node];
+    if(n->emitted) {
+        push(p, capacity, (instruction) { OP_LOAD, 0, n->slot });
+        return 1;
+    }
+
+    size_t depth = 1;
+    if(n->left >= 0) depth = emit_node(d, n->left, p, capacity);
+    if(n->right >= 0) {
+        size_t right = emit_node(d, n->right, p, capacity) + 1;
+        if(right > depth) depth = right;
+    }
+    if(n->op == OP_PARAMETER)
+        push(p, capacity, (instruction) { n->op, 0, n->value });
+    else push(p, capacity, (instruction) { n->op, n->value, 0 });
+
+    // leaves are cheaper to push again than to store
+    bool leaf = n->op == OP_CONSTANT || n->op == OP_VARIABLE ||
+                n->op == OP_PARAMETER;
+    if(n->uses > 1 && !leaf) {
+        n->emitted = true;
+        n->slot = p->num_slots++;
+        push(p, capacity, (instruction) { OP_STORE, 0, n->slot });
+    }
+
+    return depth;
+}
+
+// appends an instruction to the program, growing it if needed.
+static void push(program* p, size_t* capacity, instruction in) {
+    if(p->size == *capacity) {
+        *capacity = *capacity ? 2 * *capacity : 16;
+        p->code = realloc(p->code, *capacity * sizeof(instruction));
+    }
+    p->code[p->size++] = in;
+}
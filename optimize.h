@@ -0,0 +1,51 @@
+/**
+ *  An optimising compiler for expressions. Before the expression is
+ *  lowered into a program (see program.h), the tree is rebuilt as a
+ *  directed acyclic graph in which identical subexpressions are the
+ *  same node, and simplified along the way:
+ *
+ *   - subexpressions that don't depend on x are evaluated once, as
+ *     are products of constants like the 2 * 3 in 2 * 3 * x,
+ *   - integer powers like x^3 become chains of multiplications, and
+ *   - sec, csc and cot become reciprocals of cos, sin and tan, so
+ *     they can share work with those functions.
+ *
+ *  Nodes that are used more than once are computed the first time
+ *  they're needed, and stored in a slot for the other uses, even when
+ *  the uses are in different expressions compiled together.
+ */
+
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include "expression.h"
+#include "program.h"
+
+// the largest exponent that gets turned into multiplications. the
+// rounding error grows with every multiplication, so keep it small.
+#define MAX_UNROLLED_POWER 8
+
+/**
+ *  Compiles an expression tree into an optimised program. It gives
+ *  the same values as evaluate, except that integer powers computed
+ *  by multiplication (and products of constants) may differ in the
+ *  last bit or two. The tree is left untouched.
+ */
+program* optimize_expression(expression* e);
+
+/**
+ *  Compiles an expression like optimize_expression, except that its
+ *  parameters aren't folded in as constants: the program reads their
+ *  values each time it runs, so it stays valid as they change. Only
+ *  the parts that don't involve a parameter are folded.
+ */
+program* optimize_with_parameters(expression* e);
+
+/**
+ *  Compiles several expressions into a single program with one output
+ *  for each of them, in order. They share one graph, so anything they
+ *  have in common is only computed once for each x.
+ */
+program* optimize_expressions(expression** roots, int n);
+
+#endif
@@ -5,6 +5,7 @@
 #include "plot.h" 
 #include "plot_options.h"
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -15,6 +16,19 @@
  */ 
 #define BORDER "▒"
 
+// lists the 64 different possible characters that can be displayed. 
+// There are 6 bits in the index. The least significant bit is the 
+// upper-left sub-block, then the next bit is the upper-right, and 
+// so on and so forth (left-to-right, up-to-down). 
+const char* SEXTANTS[64] = {" ", "🬀", "🬁", "🬂", "🬃", "🬄", "🬅", "🬆", 
+                            "🬇", "🬈", "🬉", "🬊", "🬋", "🬌", "🬍", "🬎", 
+                            "🬏", "🬐", "🬑", "🬒", "🬓", "▌", "🬔", "🬕", 
+                            "🬖", "🬗", "🬘", "🬙", "🬚", "🬛", "🬜", "🬝", 
+                            "🬞", "🬟", "🬠", "🬡", "🬢", "🬣", "🬤", "🬥", 
+                            "🬦", "🬧", "▐", "🬨", "🬩", "🬪", "🬫", "🬬", 
+                            "🬭", "🬮", "🬯", "🬰", "🬱", "🬲", "🬳", "🬴", 
+                            "🬵", "🬶", "🬷", "🬸", "🬹", "🬺", "🬻", "█"}; 
+
 // forward declaration of several helper functions and structs. 
 // these are not exposed in the header. 
 #define F_STRING_LENGTH 100
@@ -61,6 +75,11 @@ format_strings* make_format_strings(plot_options* options) {
             options->tick_precision); 
     sprintf(f->x_tick_f, "%%.%dlf ", options->tick_precision); 
 
+    // a log axis spans orders of magnitude, so its ticks are given to 
+    // a number of significant figures instead 
+    if(options->x_log) 
+        sprintf(f->x_tick_f, "%%.%dlg ", options->tick_precision + 1); 
+
     return f; 
 }
 
@@ -127,6 +146,10 @@ void make_x_axis(plot_options* options, format_strings* formats) {
             if(num_ticks < position / tick_rate + 1) {
                 double x = options->x_max - options->x_min; 
                 x = options->x_min + x * position / options->width; 
+                if(options->x_log) {
+                    x = log(options->x_max / options->x_min); 
+                    x = options->x_min * exp(x * position / options->width); 
+                }
                 position += printf(formats->x_tick_f, x); 
                 num_ticks++; 
             } else position += printf(" "); 
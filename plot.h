@@ -9,6 +9,12 @@
 
 #include "plot_options.h" 
 
+// the 64 sextant characters, each of which splits a character cell 
+// into 2 columns and 3 rows of sub-blocks. bit i of the index is set 
+// if sub-block i is filled in, counting left to right and then top to 
+// bottom from the upper left. 
+extern const char* SEXTANTS[64]; 
+
 /** 
  *  This function creates a plot, provided with a matrix of (unicode)
  *  strings representing the contents of the plot itself. This matrix
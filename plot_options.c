@@ -4,6 +4,7 @@
 
 #include "plot_options.h"
 
+#include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,8 +18,9 @@
 #define Y_LABEL_KEY     260
 #define PLOT_TITLE_KEY  261
 #define Y_LABEL_W_KEY   262
-#define DATA_INPUT_KEY  263 // not implemented yet 
+#define DATA_INPUT_KEY  263
 #define NO_RESCALE_KEY  264
+#define THREADS_KEY     265
 
 static struct argp_option plot_params[] = {
     {"x-min", 'x', "NUM", 0, "Lower bound for x-axis."},
@@ -28,9 +30,9 @@ static struct argp_option plot_params[] = {
     {"width", 'w', "NUM", 0, "Width of the plot in characters."},
     {"height", 'h', "NUM", 0, "Height of the plot in characters."},
     {"no-rescale", NO_RESCALE_KEY, 0, 0, "Prevents the graph from "
-        "rescaling the axes to include all data points, which it "
-        "does by default. Does nothing if the user is plotting an "
-        "expression."}, 
+        "rescaling the axes to include all data points (or the whole "
+        "curve, if the user is plotting an expression), which it "
+        "does by default."}, 
     {"x-ticks", X_TICK_KEY, "NUM", 0, "Number of ticks on x-axis."},
     {"y-ticks", Y_TICK_KEY, "NUM", 0, "Number of ticks on y-axis."},
     {"tick-precision", TICK_PREC_KEY, "NUM", 0,
@@ -40,6 +42,11 @@ static struct argp_option plot_params[] = {
     {"title", PLOT_TITLE_KEY, "TITLE", 0, "Title of the plot."}, 
     {"y-label-width", Y_LABEL_W_KEY, "NUM", 0,
         "Width of the y-axis label and ticks"},
+    {"data-file", DATA_INPUT_KEY, "FILE", 0, "Read data from FILE "
+        "instead of stdin."}, 
+    {"threads", THREADS_KEY, "NUM", 0, "Number of threads used to "
+        "process the data, or to evaluate an expression across the "
+        "plot. Defaults to one per CPU."}, 
     {0}
 };
 
@@ -51,6 +58,14 @@ struct argp plot_options_argp = {
     plot_params, parse_plot_params, 0, 0
 }; 
 
+// the file opened with --data-file, if there is one. it's closed when 
+// the program exits, whichever way it gets there. 
+static FILE* opened_input = NULL; 
+
+static void close_data_input() {
+    if(opened_input != NULL) fclose(opened_input); 
+}
+
 /** 
  *  The argument parser for the plot's options. It assumes that 
  *  state->input is a pointer to a plot_options struct. 
@@ -107,6 +122,25 @@ error_t parse_plot_params(int key, char* arg,
     break; case Y_LABEL_W_KEY: 
         options->y_label_width = strtol(arg, NULL, 0); 
 
+    // DATA INPUT // 
+    // the new file is opened before the old one is closed, so that the 
+    // old one is still there to be closed at exit if the new one can't 
+    // be opened. 
+    break; case DATA_INPUT_KEY: {
+        FILE* input = fopen(arg, "r"); 
+        if(input == NULL) 
+            argp_failure(state, EXIT_FAILURE, errno, "%s", arg); 
+
+        if(opened_input == NULL) atexit(close_data_input); 
+        else {
+            fclose(opened_input); 
+            opened_input = NULL; 
+        }
+        options->data_input = opened_input = input; 
+    }
+    break; case THREADS_KEY: 
+        options->threads = strtol(arg, NULL, 0); 
+
     } // end of fat switch 
 
     return errno; 
@@ -125,6 +159,7 @@ plot_options default_plot_options() {
         .width = 60, 
         .height = 25, 
         .rescale = true, 
+        .x_log = false, 
 
         // tick options and formatting 
         .x_ticks = 5, 
@@ -138,7 +173,8 @@ plot_options default_plot_options() {
         .y_label_width = 10, 
 
         // data input 
-        .data_input = stdin 
+        .data_input = stdin, 
+        .threads = 0 
     }; 
 
     return default_options; 
@@ -22,6 +22,11 @@ typedef struct plot_options {
     int width, height; 
     bool rescale; 
 
+    // whether the columns are spaced evenly in log(x) rather than x, 
+    // which the plot (not the user) decides, like a histogram with 
+    // bins on a log scale. the x bounds are still the actual values. 
+    bool x_log; 
+
     // options for formatting the ticks and their precision
     int x_ticks, y_ticks; 
     int tick_precision; 
@@ -31,8 +36,10 @@ typedef struct plot_options {
     char* x_label, * y_label, * title; 
     int y_label_width; 
 
-    // option for the data input source. 
+    // option for the data input source, and the number of threads 
+    // used to parse and process it (0 means one per CPU). 
     FILE* data_input; 
+    int threads; 
 } plot_options; 
 
 // creates default options for the plot, which are arbitrarily
@@ -0,0 +1,154 @@
+/**
+ *  Implementation file for pool.h
+ */
+
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+struct thread_pool {
+    int size;                   // threads, counting the caller's
+    bool started;
+    pthread_t* workers;         // size - 1 of them, once started
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake, finished;
+
+    // the current batch. each thread runs the tasks whose index is
+    // its own, plus a multiple of the size; the caller's index is 0.
+    pool_task task;
+    void* context;
+    int num_tasks;
+    long batch;                 // increases with every batch
+    int running;                // workers still busy with it
+    bool stopping;
+};
+
+// what each worker needs to know about itself.
+typedef struct worker {
+    thread_pool* pool;
+    int index;
+} worker;
+
+// Forward declarations of helper functions.
+static void start_workers(thread_pool*);
+static void* work(void*);
+
+/**
+ *  Creates a pool. Its threads are only started once there's a batch
+ *  big enough to need them.
+ */
+thread_pool* create_pool(int threads) {
+    if(threads <= 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if(threads < 1) threads = 1;
+
+    thread_pool* pool = calloc(1, sizeof(thread_pool));
+    pool->size = threads;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->finished, NULL);
+    return pool;
+}
+
+/**
+ *  Tells the workers to stop, waits for them, and frees the pool.
+ */
+void delete_pool(thread_pool* pool) {
+    if(pool->started) {
+        pthread_mutex_lock(&pool->lock);
+        pool->stopping = true;
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+
+        for(int i = 0; i < pool->size - 1; i++)
+            pthread_join(pool->workers[i], NULL);
+        free(pool->workers);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->finished);
+    free(pool);
+}
+
+/**
+ *  The number of threads in the pool.
+ */
+int pool_size(thread_pool* pool) {
+    return pool->size;
+}
+
+/**
+ *  Hands a batch of tasks to the workers, runs the caller's share of
+ *  it, and waits for the rest. A single task (or a pool of one) is
+ *  just run on the calling thread.
+ */
+void run_in_pool(thread_pool* pool, pool_task task, void* context,
+                 int n) {
+    if(n <= 1 || pool->size == 1) {
+        for(int i = 0; i < n; i++) task(context, i);
+        return;
+    }
+    if(!pool->started) start_workers(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->context = context;
+    pool->num_tasks = n;
+    pool->running = pool->size - 1;
+    pool->batch++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(int i = 0; i < n; i += pool->size) task(context, i);
+
+    pthread_mutex_lock(&pool->lock);
+    while(pool->running > 0)
+        pthread_cond_wait(&pool->finished, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/** Implementations of helper functions **/
+// starts the worker threads, which wait for the first batch.
+static void start_workers(thread_pool* pool) {
+    pool->workers = malloc((pool->size - 1) * sizeof(pthread_t));
+    for(int i = 0; i < pool->size - 1; i++) {
+        worker* w = malloc(sizeof(worker));
+        *w = (worker) { pool, i + 1 };
+        pthread_create(&pool->workers[i], NULL, work, w);
+    }
+    pool->started = true;
+}
+
+// the loop run by each worker: wait for a new batch, run its share of
+// the tasks, and report back, until the pool is deleted.
+static void* work(void* arg) {
+    worker* w = arg;
+    thread_pool* pool = w->pool;
+    long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while(true) {
+        while(pool->batch == seen && !pool->stopping)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        if(pool->stopping) break;
+        seen = pool->batch;
+
+        pool_task task = pool->task;
+        void* context = pool->context;
+        int n = pool->num_tasks;
+        pthread_mutex_unlock(&pool->lock);
+
+        for(int i = w->index; i < n; i += pool->size) task(context, i);
+
+        pthread_mutex_lock(&pool->lock);
+        if(--pool->running == 0) pthread_cond_signal(&pool->finished);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    free(w);
+    return NULL;
+}
@@ -0,0 +1,43 @@
+/**
+ *  A pool of worker threads that can be handed one batch of tasks
+ *  after another. Starting and joining threads for every batch costs
+ *  tens of microseconds per thread, which adds up when there are many
+ *  small batches (like the levels of adaptive sampling in graph.c), so
+ *  the pool's threads are started once, when the first batch needs
+ *  them, and then wait for the next batch between runs.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+// the work done for one task: the shared context of the batch, and
+// the index of the task within it.
+typedef void (*pool_task)(void* context, int index);
+
+typedef struct thread_pool thread_pool;
+
+/**
+ *  Creates a pool with the given number of threads, counting the one
+ *  that runs the batches (0 or less means one per online CPU).
+ */
+thread_pool* create_pool(int threads);
+
+/**
+ *  Stops the pool's threads and frees it.
+ */
+void delete_pool(thread_pool* pool);
+
+/**
+ *  The number of threads in the pool, counting the caller's.
+ */
+int pool_size(thread_pool* pool);
+
+/**
+ *  Runs task(context, i) for each i from 0 to n - 1, spread over the
+ *  pool's threads, and returns once they're all done. The calling
+ *  thread runs some of the tasks itself.
+ */
+void run_in_pool(thread_pool* pool, pool_task task, void* context,
+                 int n);
+
+#endif
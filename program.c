@@ -0,0 +1,277 @@
+/** 
+ *  Implementation file for program.h
+ */ 
+
+#include "expression.h"
+#include "program.h"
+#include "vecmath.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the number of values of x run through a program at once. each
+// level of the stack holds this many values. 
+#define BATCH 512
+
+/** 
+ *  The instruction that each expression operator compiles to. 
+ */ 
+const enum opcode OPCODES[] = {
+    [CONSTANT] = OP_CONSTANT,   [VARIABLE] = OP_VARIABLE, 
+    [PARAMETER] = OP_CONSTANT, 
+    [ADD] = OP_ADD,             [MULTIPLY] = OP_MULTIPLY, 
+    [SUBTRACT] = OP_SUBTRACT,   [DIVIDE] = OP_DIVIDE, 
+    [POWER] = OP_POWER, 
+    [SINE] = OP_SINE,           [COSINE] = OP_COSINE, 
+    [TANGENT] = OP_TANGENT,     [SECANT] = OP_SECANT, 
+    [COSECANT] = OP_COSECANT,   [COTANGENT] = OP_COTANGENT, 
+    [ARCSIN] = OP_ARCSIN,       [ARCCOS] = OP_ARCCOS, 
+    [ARCTAN] = OP_ARCTAN, 
+    [LOG] = OP_LOG,             [EXP] = OP_EXP
+}; 
+
+// Forward declarations of helper functions. 
+static size_t count_nodes(expression*); 
+static size_t emit(expression*, instruction*, size_t*); 
+static void run_batch(program*, double*, size_t); 
+
+/** 
+ *  Compiles an expression tree into a flat program in postfix order.
+ */ 
+program* compile_expression(expression* e) {
+    program* p = malloc(sizeof(program)); 
+    p->size = 0; 
+    p->num_slots = 0; 
+    p->num_outputs = 1; 
+    p->parameters = NULL; 
+    p->num_parameters = 0; 
+    p->code = malloc(count_nodes(e) * sizeof(instruction)); 
+    p->max_depth = emit(e, p->code, &p->size); 
+    return p; 
+}
+
+/** 
+ *  Frees a program created by compile_expression. 
+ */ 
+void delete_program(program* p) {
+    free(p->code); 
+    free(p->parameters); 
+    free(p); 
+}
+
+/** 
+ *  Runs the program for the provided value of x. 
+ */ 
+double run_program(program* p, double x) {
+    double stack[p->max_depth]; 
+    double slots[p->num_slots + 1]; 
+    double* top = stack - 1;    // the value on top of the stack 
+
+    const instruction* code = p->code; 
+    const instruction* end = code + p->size; 
+    for(; code < end; code++) {
+        switch(code->op) {
+            // pushing values 
+            case OP_CONSTANT:   *++top = code->value;   break; 
+            case OP_VARIABLE:   *++top = x;             break; 
+            case OP_PARAMETER: 
+                *++top = *p->parameters[code->slot];    break; 
+
+            // arithmetic operations 
+            case OP_ADD:        top[-1] += top[0]; top--;   break; 
+            case OP_SUBTRACT:   top[-1] -= top[0]; top--;   break; 
+            case OP_MULTIPLY:   top[-1] *= top[0]; top--;   break; 
+            case OP_DIVIDE:     top[-1] /= top[0]; top--;   break; 
+            case OP_POWER:      
+                top[-1] = pow(top[-1], top[0]); top--;  break; 
+
+            // trigonometric functions 
+            case OP_SINE:       *top = sin(*top);       break; 
+            case OP_COSINE:     *top = cos(*top);       break; 
+            case OP_TANGENT:    *top = tan(*top);       break; 
+            case OP_SECANT:     *top = 1.0 / cos(*top); break; 
+            case OP_COSECANT:   *top = 1.0 / sin(*top); break; 
+            case OP_COTANGENT:  *top = 1.0 / tan(*top); break; 
+
+            // inverse trig functions 
+            case OP_ARCSIN:     *top = asin(*top);      break; 
+            case OP_ARCCOS:     *top = acos(*top);      break; 
+            case OP_ARCTAN:     *top = atan(*top);      break; 
+
+            // log and exp 
+            case OP_LOG:        *top = log(*top);       break; 
+            case OP_EXP:        *top = exp(*top);       break; 
+
+            // reusing values 
+            case OP_STORE:      slots[code->slot] = *top;       break; 
+            case OP_LOAD:       *++top = slots[code->slot];     break; 
+        }
+    }
+
+    return *top; 
+}
+
+/** 
+ *  Runs the program for each of the n values in xs, a batch at a 
+ *  time, storing the results in ys. 
+ */ 
+void run_program_batch(program* p, const double* xs, double* ys, 
+                       size_t n) {
+    // the stack's levels are followed by the slots, a batch each
+    size_t levels = p->max_depth + p->num_slots; 
+    double* stack = aligned_alloc(sizeof(vdouble), 
+                                  levels * BATCH * sizeof(double)); 
+
+    for(size_t start = 0; start < n; start += BATCH) {
+        size_t count = n - start < BATCH ? n - start : BATCH; 
+
+        // the kernels work on whole vectors, so pad the batch out 
+        // with zeros. the results for the padding are thrown away.
+        size_t padded = (count + LANES - 1) / LANES * LANES; 
+        memcpy(stack, xs + start, count * sizeof(double)); 
+        memset(stack + count, 0, (padded - count) * sizeof(double)); 
+
+        run_batch(p, stack, padded); 
+
+        // each output is left on its own level of the stack 
+        size_t outputs = p->num_outputs; 
+        if(outputs == 1) memcpy(ys + start, stack, count * sizeof(double));
+        else {
+            for(size_t k = 0; k < outputs; k++) 
+                for(size_t i = 0; i < count; i++) 
+                    ys[(start + i) * outputs + k] = stack[k * BATCH + i]; 
+        }
+    }
+
+    free(stack); 
+}
+
+/** Implementations of helper functions **/ 
+// runs the program over a batch of n values of x, which are stored 
+// in the first level of the stack. the results end up there as well.
+// n must be a multiple of LANES. 
+__attribute__((target_clones("avx512f", "avx2", "default"))) 
+static void run_batch(program* p, double* stack, size_t n) {
+    // keep the values of x aside; the first instruction overwrites them
+    double xs[BATCH] __attribute__((aligned(sizeof(vdouble)))); 
+    memcpy(xs, stack, n * sizeof(double)); 
+
+    double* top = stack - BATCH;    // the level on top of the stack 
+    double* slots = stack + p->max_depth * BATCH; 
+    size_t vectors = n / LANES; 
+
+    for(size_t i = 0; i < p->size; i++) {
+        instruction* in = &p->code[i]; 
+        vdouble* t = (vdouble*) top; 
+        vdouble* below = (vdouble*) (top - BATCH); 
+
+        switch(in->op) {
+            // pushing values 
+            case OP_CONSTANT: 
+                top += BATCH; 
+                for(size_t j = 0; j < n; j++) top[j] = in->value; 
+                break; 
+            case OP_VARIABLE: 
+                top += BATCH; 
+                memcpy(top, xs, n * sizeof(double)); 
+                break; 
+            case OP_PARAMETER: {
+                double value = *p->parameters[in->slot]; 
+                top += BATCH; 
+                for(size_t j = 0; j < n; j++) top[j] = value; 
+                break; 
+            }
+
+            // arithmetic operations 
+            case OP_ADD: 
+                for(size_t j = 0; j < vectors; j++) below[j] += t[j]; 
+                top -= BATCH; 
+                break; 
+            case OP_SUBTRACT: 
+                for(size_t j = 0; j < vectors; j++) below[j] -= t[j]; 
+                top -= BATCH; 
+                break; 
+            case OP_MULTIPLY: 
+                for(size_t j = 0; j < vectors; j++) below[j] *= t[j]; 
+                top -= BATCH; 
+                break; 
+            case OP_DIVIDE: 
+                for(size_t j = 0; j < vectors; j++) below[j] /= t[j]; 
+                top -= BATCH; 
+                break; 
+            case OP_POWER: 
+                vec_pow(top - BATCH, top, n); 
+                top -= BATCH; 
+                break; 
+
+            // trigonometric functions 
+            case OP_SINE:       vec_sin(top, n);    break; 
+            case OP_COSINE:     vec_cos(top, n);    break; 
+            case OP_TANGENT:    vec_tan(top, n);    break; 
+            case OP_SECANT: 
+                vec_cos(top, n); 
+                for(size_t j = 0; j < vectors; j++) t[j] = 1.0 / t[j]; 
+                break; 
+            case OP_COSECANT: 
+                vec_sin(top, n); 
+                for(size_t j = 0; j < vectors; j++) t[j] = 1.0 / t[j]; 
+                break; 
+            case OP_COTANGENT: 
+                vec_tan(top, n); 
+                for(size_t j = 0; j < vectors; j++) t[j] = 1.0 / t[j]; 
+                break; 
+
+            // inverse trig functions have no vector kernels
+            case OP_ARCSIN: 
+                for(size_t j = 0; j < n; j++) top[j] = asin(top[j]); 
+                break; 
+            case OP_ARCCOS: 
+                for(size_t j = 0; j < n; j++) top[j] = acos(top[j]); 
+                break; 
+            case OP_ARCTAN: 
+                for(size_t j = 0; j < n; j++) top[j] = atan(top[j]); 
+                break; 
+
+            // log and exp 
+            case OP_LOG:        vec_log(top, n);    break; 
+            case OP_EXP:        vec_exp(top, n);    break; 
+
+            // reusing values 
+            case OP_STORE: 
+                memcpy(slots + in->slot * BATCH, top, n * sizeof(double));
+                break; 
+            case OP_LOAD: 
+                top += BATCH; 
+                memcpy(top, slots + in->slot * BATCH, n * sizeof(double));
+                break; 
+        }
+    }
+}
+
+
+// counts the nodes in an expression tree, which is the number of 
+// instructions it compiles to. 
+static size_t count_nodes(expression* e) {
+    if(e == NULL) return 0; 
+    return 1 + count_nodes(e->left) + count_nodes(e->right); 
+}
+
+// appends the instructions for the tree rooted at e to the code, 
+// children first. returns the stack depth needed to run them. 
+static size_t emit(expression* e, instruction* code, size_t* size) {
+    size_t depth = 1; 
+    if(e->left != NULL) depth = emit(e->left, code, size); 
+
+    // the left operand sits on the stack while the right is computed
+    if(e->right != NULL) {
+        size_t right = emit(e->right, code, size) + 1; 
+        if(right > depth) depth = right; 
+    }
+
+    code[*size].op = OPCODES[e->operation]; 
+    code[*size].value = e->value; 
+    code[*size].slot = 0; 
+    ++*size; 
+    return depth; 
+}
@@ -0,0 +1,96 @@
+/** 
+ *  Compiled expressions. Rather than walking an expression tree for 
+ *  every value of x, the tree is lowered once into a flat program in
+ *  postfix order, which a small stack machine then runs. Constants 
+ *  are stored inline in the instructions that push them, so running 
+ *  a program is a single loop over a contiguous array with no 
+ *  recursion or pointer chasing. 
+ */ 
+
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include "expression.h"
+
+#include <stddef.h>
+
+// the instructions understood by the stack machine. each of them 
+// corresponds to one of the expression operators. 
+enum opcode {
+    // push a value onto the stack. OP_PARAMETER pushes the current 
+    // value of a parameter (see optimize_with_parameters). 
+    OP_CONSTANT, OP_VARIABLE, OP_PARAMETER, 
+
+    // pop two values and push the result 
+    OP_ADD, OP_MULTIPLY, OP_SUBTRACT, OP_DIVIDE, OP_POWER, 
+
+    // replace the value on top of the stack 
+    OP_SINE, OP_COSINE, OP_TANGENT, 
+    OP_SECANT, OP_COSECANT, OP_COTANGENT, 
+    OP_ARCSIN, OP_ARCCOS, OP_ARCTAN, 
+    OP_LOG, OP_EXP, 
+
+    // copy the top of the stack into a slot, or push a slot's value.
+    // these let a value that's needed more than once be reused. 
+    OP_STORE, OP_LOAD
+}; 
+
+// the instruction that each expression operator compiles to, 
+// indexed by the operator. parameters are compiled as constants, 
+// using their values at the time. 
+extern const enum opcode OPCODES[]; 
+
+typedef struct instruction {
+    enum opcode op; 
+    double value;       // the value pushed by OP_CONSTANT 
+    size_t slot;        // the slot used by OP_STORE and OP_LOAD, or 
+                        // the parameter pushed by OP_PARAMETER 
+} instruction; 
+
+typedef struct program {
+    size_t size;        // number of instructions 
+    size_t max_depth;   // deepest the stack gets while running 
+    size_t num_slots;   // number of slots used to store values 
+    size_t num_outputs; // values left on the stack at the end 
+    instruction* code; 
+
+    // where the values of the parameters are read from while the 
+    // program runs, if any of them are left in it 
+    const double** parameters; 
+    size_t num_parameters; 
+} program; 
+
+/** 
+ *  Compiles an expression tree into a program that computes the same
+ *  values. The tree is left untouched and may be deleted afterwards.
+ */ 
+program* compile_expression(expression* e); 
+
+/** 
+ *  Frees a program created by compile_expression. 
+ */ 
+void delete_program(program* p); 
+
+/** 
+ *  Runs the program for the provided value of x. The result is the 
+ *  same as evaluating the original expression tree at x. For a 
+ *  program with several outputs, this is the last of them. 
+ */ 
+double run_program(program* p, double x); 
+
+/** 
+ *  Runs the program for each of the n values in xs, storing the 
+ *  results in ys. The values are processed in batches, each 
+ *  instruction being applied to a whole batch at once with vector 
+ *  instructions (see vecmath.h), which is much faster than calling 
+ *  run_program for every x. Transcendental functions may differ from 
+ *  run_program in the last bit or two. 
+ * 
+ *  If the program has several outputs (see optimize_expressions), 
+ *  ys must hold n of each, and the outputs for xs[i] are stored 
+ *  together starting at ys[i * num_outputs]. 
+ */ 
+void run_program_batch(program* p, const double* xs, double* ys, 
+                       size_t n); 
+
+#endif 
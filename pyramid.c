@@ -0,0 +1,269 @@
+/**
+ *  Implementation file for pyramid.h
+ */
+
+#include "pyramid.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAGIC           "CUPIDX1"
+#define WRITE_BLOCK     4096    // entries buffered per level
+
+// a level of the pyramid that is being written out.
+typedef struct level_writer {
+    char* block;
+    size_t entry_size, count;
+    off_t offset;               // where the next block goes
+    bucket open;                // bucket currently being filled
+} level_writer;
+
+// Forward declarations of helper functions.
+static void add_bucket(level_writer*, size_t, int, size_t, bucket*);
+static void emit(int, level_writer*, const void*);
+static void flush_level(int, level_writer*);
+static void merge_bucket(bucket*, bucket*);
+static void visit(pyramid*, envelope*, size_t, size_t, size_t);
+
+/**
+ *  Writes an index of the points in the sorted stream to the file at
+ *  the given path.
+ */
+void write_pyramid(point_stream* s, const char* path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    // the number of points is known up front, so the size (and hence
+    // the position) of every level can be worked out before writing.
+    size_t num_levels = 1;
+    for(size_t n = s->size; n > BRANCHING; num_levels++)
+        n = (n + BRANCHING - 1) / BRANCHING;
+
+    pyramid_header header = { MAGIC, s->size, num_levels,
+                              s->x_min, s->x_max, s->y_min, s->y_max };
+    pyramid_level* levels = malloc(num_levels * sizeof(pyramid_level));
+    level_writer* writers = calloc(num_levels, sizeof(level_writer));
+
+    off_t offset = sizeof(pyramid_header) +
+                   num_levels * sizeof(pyramid_level);
+    size_t count = s->size;
+    for(size_t i = 0; i < num_levels; i++) {
+        writers[i].entry_size = i == 0 ? 2 * sizeof(double)
+                                       : sizeof(bucket);
+        writers[i].block = malloc(WRITE_BLOCK * writers[i].entry_size);
+        writers[i].offset = offset;
+        levels[i] = (pyramid_level) { offset, count };
+
+        offset += count * writers[i].entry_size;
+        count = (count + BRANCHING - 1) / BRANCHING;
+    }
+
+    // every point goes into level 0 and the open bucket of level 1.
+    // whenever a bucket fills up, it is written out and merged into
+    // the open bucket of the level above.
+    double x, y;
+    while(next_point(s, &x, &y)) {
+        double pair[2] = { x, y };
+        emit(fd, &writers[0], pair);
+
+        bucket point = { x, y, x, y, y, y, y, 1 };
+        if(num_levels > 1)
+            add_bucket(writers, num_levels, fd, 1, &point);
+    }
+
+    // write out whatever is left in the partially filled buckets.
+    for(size_t i = 1; i < num_levels; i++) {
+        if(writers[i].open.count > 0) emit(fd, &writers[i],
+                                           &writers[i].open);
+        if(i + 1 < num_levels && writers[i].open.count > 0)
+            merge_bucket(&writers[i + 1].open, &writers[i].open);
+    }
+
+    for(size_t i = 0; i < num_levels; i++) {
+        flush_level(fd, &writers[i]);
+        free(writers[i].block);
+    }
+
+    if(pwrite(fd, &header, sizeof(header), 0) != sizeof(header) ||
+       pwrite(fd, levels, num_levels * sizeof(pyramid_level),
+              sizeof(header)) != num_levels * sizeof(pyramid_level) ||
+       close(fd) != 0) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    free(levels);
+    free(writers);
+}
+
+/**
+ *  Maps the index file at the given path into memory. Returns NULL
+ *  if it can't be opened or isn't a valid index.
+ */
+pyramid* open_pyramid(const char* path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        if(fd >= 0) close(fd);
+        return NULL;
+    }
+
+    void* map = MAP_FAILED;
+    if(st.st_size >= sizeof(pyramid_header))
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    pyramid* p = malloc(sizeof(pyramid));
+    p->map = map;
+    p->length = st.st_size;
+    p->header = map;
+    p->levels = (pyramid_level*) (p->header + 1);
+
+    // check that the file is an index, and that it's large enough to
+    // contain everything the header says it does.
+    bool valid = map != MAP_FAILED &&
+                 memcmp(p->header->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 p->header->num_levels > 0 &&
+                 p->header->num_levels <= 64;
+    size_t needed = sizeof(pyramid_header) +
+                    (valid ? p->header->num_levels : 0) *
+                    sizeof(pyramid_level);
+    valid = valid && needed <= p->length;
+
+    for(size_t i = 0; valid && i < p->header->num_levels; i++) {
+        size_t entry_size = i == 0 ? 2 * sizeof(double)
+                                   : sizeof(bucket);
+        valid = p->levels[i].offset <= p->length &&
+                p->levels[i].count <=
+                (p->length - p->levels[i].offset) / entry_size;
+    }
+
+    if(!valid) {
+        fprintf(stderr, "%s: not a valid index file\n", path);
+        close_pyramid(p);
+        return NULL;
+    }
+
+    return p;
+}
+
+/**
+ *  Unmaps and frees an index opened by open_pyramid.
+ */
+void close_pyramid(pyramid* p) {
+    if(p->map != MAP_FAILED) munmap(p->map, p->length);
+    free(p);
+}
+
+/**
+ *  Adds all of the indexed points to an envelope, expanding only the
+ *  buckets that straddle a column border.
+ */
+void pyramid_envelope(pyramid* p, envelope* e) {
+    size_t top = p->header->num_levels - 1;
+    visit(p, e, top, 0, p->levels[top].count);
+}
+
+/** Implementations of helper functions **/
+// adds a bucket from the level below to the open bucket of the given
+// level, writing it out (and moving up a level) once it's full.
+static void add_bucket(level_writer* writers, size_t num_levels,
+                       int fd, size_t level, bucket* b) {
+    level_writer* w = &writers[level];
+    merge_bucket(&w->open, b);
+
+    // a bucket on level i holds BRANCHING^i points.
+    size_t full = 1;
+    for(size_t i = 0; i < level; i++) full *= BRANCHING;
+    if(w->open.count < full) return;
+
+    emit(fd, w, &w->open);
+    bucket done = w->open;
+    w->open.count = 0;
+
+    if(level + 1 < num_levels)
+        add_bucket(writers, num_levels, fd, level + 1, &done);
+}
+
+// merges the bucket b, whose points all come after those in the
+// bucket into, into it.
+static void merge_bucket(bucket* into, bucket* b) {
+    if(into->count == 0) {
+        *into = *b;
+        return;
+    }
+
+    into->last_x = b->last_x;
+    into->last_y = b->last_y;
+    if(b->min < into->min) into->min = b->min;
+    if(b->max > into->max) into->max = b->max;
+    into->sum += b->sum;
+    into->count += b->count;
+}
+
+// buffers an entry for writing to the given level.
+static void emit(int fd, level_writer* w, const void* entry) {
+    memcpy(w->block + w->count * w->entry_size, entry, w->entry_size);
+    if(++w->count == WRITE_BLOCK) flush_level(fd, w);
+}
+
+// writes out the entries buffered for the given level.
+static void flush_level(int fd, level_writer* w) {
+    size_t length = w->count * w->entry_size;
+    if(pwrite(fd, w->block, length, w->offset) != length) {
+        perror("writing index");
+        exit(EXIT_FAILURE);
+    }
+
+    w->offset += length;
+    w->count = 0;
+}
+
+// adds the entries [first, last) of the given level to the envelope.
+// buckets entirely outside the envelope only contribute the point
+// closest to it, and buckets inside a single column are merged in
+// whole; the rest are split into the buckets of the level below.
+static void visit(pyramid* p, envelope* e, size_t level,
+                  size_t first, size_t last) {
+    char* data = (char*) p->map + p->levels[level].offset;
+
+    if(level == 0) {
+        double* points = (double*) data;
+        for(size_t i = first; i < last; i++)
+            add_to_envelope(e, points[2 * i], points[2 * i + 1]);
+        return;
+    }
+
+    bucket* buckets = (bucket*) data;
+    for(size_t i = first; i < last; i++) {
+        bucket* b = &buckets[i];
+        int lo = envelope_column(e, b->first_x);
+        int hi = envelope_column(e, b->last_x);
+
+        if(hi < 0) {
+            add_to_envelope(e, b->last_x, b->last_y);
+        } else if(lo >= e->width) {
+            add_to_envelope(e, b->first_x, b->first_y);
+        } else if(lo == hi) {
+            column_summary s = { b->count, b->first_x, b->first_y,
+                                 b->last_x, b->last_y, b->min, b->max };
+            merge_into_envelope(e, lo, &s);
+        } else {
+            size_t below = p->levels[level - 1].count;
+            size_t start = i * BRANCHING;
+            size_t end = start + BRANCHING < below ? start + BRANCHING
+                                                   : below;
+            visit(p, e, level - 1, start, end);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+/** 
+ *  Level-of-detail index files for large data sets. An index holds 
+ *  the sorted points themselves (level 0), plus a pyramid of coarser
+ *  levels in which every bucket summarises BRANCHING buckets of the 
+ *  level below: the first and last points, the minimum, maximum and 
+ *  sum of the y-values, and the number of points. Bucket sizes are 
+ *  therefore powers of two - 8, 64, 512 points and so on. 
+ *  
+ *  Building an index takes a full sort of the data, but afterwards 
+ *  any x-range can be drawn by reading only the handful of buckets 
+ *  that it needs out of the memory-mapped file. The file is written 
+ *  in the machine's native byte order. 
+ */ 
+
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include "envelope.h"
+#include "sort.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BRANCHING 8
+
+// the header at the start of an index file. it is followed by 
+// num_levels level descriptors, and then the levels themselves. 
+typedef struct pyramid_header {
+    char magic[8]; 
+    uint64_t num_points, num_levels; 
+    double x_min, x_max, y_min, y_max; 
+} pyramid_header; 
+
+// where a level is stored in the file, and how many entries it has.
+// level 0 holds interleaved (x, y) pairs, the others hold buckets. 
+typedef struct pyramid_level {
+    uint64_t offset, count; 
+} pyramid_level; 
+
+// a summary of a run of consecutive points. 
+typedef struct bucket {
+    double first_x, first_y, last_x, last_y; 
+    double min, max, sum; 
+    uint64_t count; 
+} bucket; 
+
+// an index file that has been mapped into memory. 
+typedef struct pyramid {
+    void* map; 
+    size_t length; 
+    pyramid_header* header; 
+    pyramid_level* levels; 
+} pyramid; 
+
+/** 
+ *  Writes an index of the points in the stream, which must be sorted,
+ *  to the file at the given path. Exits with an error message if the 
+ *  file can't be written. 
+ */ 
+void write_pyramid(point_stream* s, const char* path); 
+
+/** 
+ *  Maps the index file at the given path into memory. Returns NULL 
+ *  (after printing the reason) if it can't be opened or isn't valid.
+ */ 
+pyramid* open_pyramid(const char* path); 
+
+/** 
+ *  Unmaps and frees an index opened by open_pyramid. 
+ */ 
+void close_pyramid(pyramid* p); 
+
+/** 
+ *  Adds all of the indexed points to an envelope. Buckets that lie 
+ *  within a single column of the envelope are added in one go, so 
+ *  only buckets straddling a column border are expanded into the 
+ *  level below. The result is the same as adding every point. 
+ */ 
+void pyramid_envelope(pyramid* p, envelope* e); 
+
+#endif 
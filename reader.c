@@ -0,0 +1,465 @@
+/**
+ *  Implementation file for reader.h
+ */
+
+#define _GNU_SOURCE // for strtod_l
+
+#include "reader.h"
+
+#include <errno.h>
+#include <locale.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// size of the chunks handed to read(). this is also the initial
+// capacity of the reader's buffer, which only ever grows if a single
+// token is longer than the entire buffer.
+#define BLOCK_SIZE (1 << 20)
+
+// the longest token we'll ever print out in an error message
+#define MAX_REPORT_LENGTH 32
+
+// the smallest chunk of a mapped file worth handing to its own
+// thread; anything less and the thread costs more than it saves.
+#define MIN_CHUNK_SIZE (1 << 22)
+
+// lookup table for the characters that separate two tokens. this is
+// faster than isspace() and doesn't depend on the current locale.
+static const bool SEPARATOR[256] = {
+    [' '] = true, ['\t'] = true, ['\n'] = true, ['\v'] = true,
+    ['\f'] = true, ['\r'] = true, [','] = true
+};
+
+// exact powers of ten. every one of these is representable as a
+// double, which is what makes the fast path in parse_value exact.
+#define MAX_EXACT_POWER 22
+static const double POWERS_OF_TEN[MAX_EXACT_POWER + 1] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+    1e22
+};
+
+// the largest mantissa that can be stored exactly in a double.
+#define MAX_EXACT_MANTISSA (UINT64_C(1) << 53)
+
+// one newline-aligned piece of a memory-mapped file, together with
+// the values parsed out of it by a single thread. malformed tokens
+// are only recorded here; they're reported once every thread is
+// done, so that the line numbers can be made global.
+typedef struct malformed {
+    const char* token;
+    size_t length, line;
+} malformed;
+
+typedef struct chunk {
+    const char* start, * end;
+
+    double* values;
+    size_t count, capacity;
+
+    size_t lines;   // number of newlines in the chunk
+    malformed* errors;
+    size_t num_errors, errors_capacity;
+} chunk;
+
+// forward declarations of helper functions
+static bool fill_buffer(reader*);
+static bool parse_slow(const char*, const char*, double*);
+static locale_t c_locale();
+static value_list* read_sequential(FILE*);
+static void* parse_chunk(void*);
+static void report(const char*, size_t, size_t);
+
+/**
+ *  Creates a reader that pulls its data from the provided file.
+ */
+reader* create_reader(FILE* fp) {
+    reader* r = malloc(sizeof(reader));
+    r->fd = fileno(fp);
+    r->buffer = malloc(BLOCK_SIZE);
+    r->start = r->end = 0;
+    r->capacity = BLOCK_SIZE;
+    r->eof = false;
+    r->line = 1;
+    r->errors = 0;
+    r->quiet = false;
+    return r;
+}
+
+/**
+ *  Frees the reader and its buffer, but not the underlying file.
+ */
+void delete_reader(reader* r) {
+    free(r->buffer);
+    free(r);
+}
+
+/**
+ *  Reads the next number from the input into *value. Returns false
+ *  once the input is exhausted. Malformed tokens are reported on
+ *  stderr and skipped.
+ */
+bool read_value(reader* r, double* value) {
+    while(true) {
+        // skip over any separators, keeping track of the line
+        while(r->start < r->end &&
+              SEPARATOR[(unsigned char) r->buffer[r->start]]) {
+            if(r->buffer[r->start] == '\n') r->line++;
+            r->start++;
+        }
+
+        // out of data: read more, or stop if there's nothing left
+        if(r->start == r->end) {
+            if(!fill_buffer(r)) return false;
+            continue;
+        }
+
+        // find the end of the token. if it runs into the end of the
+        // buffer, it might continue in the next block.
+        size_t end = r->start;
+        while(end < r->end &&
+              !SEPARATOR[(unsigned char) r->buffer[end]]) end++;
+
+        if(end == r->end && !r->eof) {
+            fill_buffer(r);
+            continue;
+        }
+
+        const char* token = r->buffer + r->start;
+        size_t length = end - r->start;
+        r->start = end;
+        if(parse_value(token, token + length, value)) return true;
+
+        // malformed token - report it and move on to the next one
+        r->errors++;
+        if(!r->quiet) report(token, length, r->line);
+    }
+}
+
+/**
+ *  Reads every number in the file into a new value list. Regular
+ *  files are mapped into memory and parsed in parallel; anything
+ *  else is read sequentially.
+ */
+value_list* read_all_values(FILE* fp, int threads) {
+    struct stat info;
+    int fd = fileno(fp);
+    off_t offset = ftello(fp);
+    if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+       offset < 0 || offset >= info.st_size)
+        return read_sequential(fp);
+
+    // the data starts wherever the file has got to, but the mapping
+    // has to start on a page boundary
+    off_t page = offset - offset % sysconf(_SC_PAGESIZE);
+    size_t mapped = info.st_size - page;
+    char* map = mmap(NULL, mapped, PROT_READ, MAP_PRIVATE, fd, page);
+    if(map == MAP_FAILED) return read_sequential(fp);
+    madvise(map, mapped, MADV_SEQUENTIAL);
+
+    char* data = map + (offset - page);
+    size_t size = info.st_size - offset;
+
+    // don't spin up more threads than there is data to parse
+    if(threads <= 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if(threads > size / MIN_CHUNK_SIZE + 1)
+        threads = size / MIN_CHUNK_SIZE + 1;
+    if(threads < 1) threads = 1;
+
+    // split the file into roughly equal chunks, each of which ends
+    // just after a newline (or at the end of the file).
+    chunk* chunks = calloc(threads, sizeof(chunk));
+    const char* position = data, * end = data + size;
+    for(int i = 0; i < threads; i++) {
+        const char* stop = data + size / threads * (i + 1);
+        if(i == threads - 1 || stop < position) stop = end;
+        while(stop < end && stop[-1] != '\n') stop++;
+
+        chunks[i].start = position;
+        chunks[i].end = position = stop;
+    }
+
+    // the locale used by the slow path is created lazily, so make
+    // sure that happens before any of the threads need it.
+    c_locale();
+
+    pthread_t* workers = malloc(threads * sizeof(pthread_t));
+    for(int i = 1; i < threads; i++)
+        pthread_create(&workers[i], NULL, parse_chunk, &chunks[i]);
+    parse_chunk(&chunks[0]);
+    for(int i = 1; i < threads; i++)
+        pthread_join(workers[i], NULL);
+
+    // concatenate the per-thread results, reporting errors in order
+    size_t total = 0, line = 1;
+    for(int i = 0; i < threads; i++) total += chunks[i].count;
+
+    // the first chunk's values are already in place, so its buffer
+    // becomes the list, and only the later chunks are copied after it
+    value_list* values = malloc(sizeof(value_list));
+    values->data = chunks[0].values;
+    values->capacity = chunks[0].capacity;
+    values->size = 0;
+    if(total > values->capacity || values->data == NULL) {
+        values->capacity = total > 8 ? total : 8;
+        values->data = realloc(values->data,
+                               values->capacity * sizeof(double));
+    }
+    chunks[0].values = NULL;
+
+    for(int i = 0; i < threads; i++) {
+        chunk* c = &chunks[i];
+        if(i > 0 && c->count > 0)
+            memcpy(values->data + values->size, c->values,
+                   c->count * sizeof(double));
+        values->size += c->count;
+
+        for(size_t j = 0; j < c->num_errors; j++) {
+            malformed* m = &c->errors[j];
+            report(m->token, m->length, line + m->line);
+        }
+
+        line += c->lines;
+        free(c->values);
+        free(c->errors);
+    }
+
+    free(workers);
+    free(chunks);
+    munmap(map, mapped);
+    return values;
+}
+
+/**
+ *  Reads every pair of numbers in the file into a new point list.
+ *  An unpaired value at the very end is dropped.
+ */
+point_list* read_all_points(FILE* fp, int threads) {
+    value_list* values = read_all_values(fp, threads);
+    size_t count = values->size / 2;
+    if(count == 0) {
+        delete_value_list(values);
+        return create_point_list();
+    }
+
+    // the y values are copied out, and then the x values are packed
+    // down into the front of the same buffer, which is never ahead of
+    // where they're being read from.
+    double* data = values->data;
+    double* y = malloc(count * sizeof(double));
+    for(size_t i = 0; i < count; i++) y[i] = data[2 * i + 1];
+    for(size_t i = 0; i < count; i++) data[i] = data[2 * i];
+
+    point_list* points = malloc(sizeof(point_list));
+    points->x = realloc(data, count * sizeof(double));
+    points->y = y;
+    points->size = points->capacity = count;
+
+    free(values);
+    return points;
+}
+
+/**
+ *  Parses a number from the characters in [s, end). Numbers with at
+ *  most 19 significant digits and a small decimal exponent are
+ *  converted exactly with a single multiplication or division (the
+ *  Clinger fast path), which covers nearly all real-world data;
+ *  everything else falls back to strtod in the C locale.
+ */
+bool parse_value(const char* s, const char* end, double* value) {
+    const char* p = s;
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    // accumulate up to 19 significant digits into the mantissa. any
+    // more than that and we can't guarantee an exact result.
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any_digits = false, truncated = false;
+
+    for(; p < end && '0' <= *p && *p <= '9'; p++) {
+        any_digits = true;
+        if(digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if(mantissa > 0) digits++;
+        } else {
+            truncated = true;
+            exponent++;
+        }
+    }
+
+    if(p < end && *p == '.') {
+        for(p++; p < end && '0' <= *p && *p <= '9'; p++) {
+            any_digits = true;
+            if(digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if(mantissa > 0) digits++;
+                exponent--;
+            } else truncated = true;
+        }
+    }
+
+    // optional exponent. clamp it so absurd inputs can't overflow;
+    // they're handed off to strtod anyway.
+    if(any_digits && p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negative_exp = false;
+        if(q < end && (*q == '-' || *q == '+'))
+            negative_exp = *q++ == '-';
+
+        if(q < end && '0' <= *q && *q <= '9') {
+            int e = 0;
+            for(; q < end && '0' <= *q && *q <= '9'; q++)
+                if(e < 100000) e = e * 10 + (*q - '0');
+            exponent += negative_exp ? -e : e;
+            p = q;
+        }
+    }
+
+    // anything unusual (inf, nan, hex floats, trailing garbage) goes
+    // through the slow path.
+    if(!any_digits || p != end) return parse_slow(s, end, value);
+
+    if(mantissa == 0) {
+        *value = negative ? -0.0 : 0.0;
+        return true;
+    }
+
+    if(truncated || mantissa > MAX_EXACT_MANTISSA ||
+       exponent < -MAX_EXACT_POWER || exponent > MAX_EXACT_POWER)
+        return parse_slow(s, end, value);
+
+    double result = (double) mantissa;
+    if(exponent < 0) result /= POWERS_OF_TEN[-exponent];
+    else             result *= POWERS_OF_TEN[exponent];
+
+    *value = negative ? -result : result;
+    return true;
+}
+
+/** Implementations of helper functions **/
+// moves any unparsed bytes to the front of the buffer and reads the
+// next block after them. returns false if nothing more could be
+// read, i.e. we've reached the end of the input.
+static bool fill_buffer(reader* r) {
+    if(r->eof) return false;
+
+    size_t remaining = r->end - r->start;
+    memmove(r->buffer, r->buffer + r->start, remaining);
+    r->start = 0;
+    r->end = remaining;
+
+    // a single token filled the entire buffer, so make room
+    if(r->end == r->capacity) {
+        r->capacity *= 2;
+        r->buffer = realloc(r->buffer, r->capacity);
+    }
+
+    ssize_t n;
+    do {
+        n = read(r->fd, r->buffer + r->end, r->capacity - r->end);
+    } while(n < 0 && errno == EINTR);
+
+    if(n <= 0) {
+        if(n < 0) perror("read");
+        r->eof = true;
+        return false;
+    }
+
+    r->end += n;
+    return true;
+}
+
+// parses a number using strtod in the C locale, so the decimal point
+// is always '.' regardless of the user's environment. the token must
+// be consumed in its entirety.
+static bool parse_slow(const char* s, const char* end, double* value) {
+    char small[64];
+    size_t length = end - s;
+    char* copy = length < sizeof(small) ? small : malloc(length + 1);
+    memcpy(copy, s, length);
+    copy[length] = 0;
+
+    char* stop;
+    double result = strtod_l(copy, &stop, c_locale());
+    bool ok = length > 0 && stop == copy + length;
+    if(ok) *value = result;
+
+    if(copy != small) free(copy);
+    return ok;
+}
+
+// reads all of the values out of a file that can't be mapped into
+// memory, using a regular reader.
+static value_list* read_sequential(FILE* fp) {
+    reader* r = create_reader(fp);
+    value_list* values = create_value_list();
+
+    double value;
+    while(read_value(r, &value)) append_value_list(values, value);
+
+    delete_reader(r);
+    return values;
+}
+
+// parses every value in a single chunk of a mapped file. this is the
+// entry point for each of the worker threads.
+static void* parse_chunk(void* arg) {
+    chunk* c = arg;
+    const char* p = c->start;
+
+    while(true) {
+        while(p < c->end && SEPARATOR[(unsigned char) *p]) {
+            if(*p == '\n') c->lines++;
+            p++;
+        }
+        if(p == c->end) break;
+
+        const char* token = p;
+        while(p < c->end && !SEPARATOR[(unsigned char) *p]) p++;
+
+        double value;
+        if(parse_value(token, p, &value)) {
+            if(c->count >= c->capacity) {
+                c->capacity = c->capacity ? c->capacity * 2 : 1024;
+                c->values = realloc(c->values,
+                                    c->capacity * sizeof(double));
+            }
+            c->values[c->count++] = value;
+            continue;
+        }
+
+        if(c->num_errors >= c->errors_capacity) {
+            c->errors_capacity = c->errors_capacity ?
+                                 c->errors_capacity * 2 : 8;
+            c->errors = realloc(c->errors,
+                                c->errors_capacity * sizeof(malformed));
+        }
+        c->errors[c->num_errors++] = (malformed) {
+            token, p - token, c->lines
+        };
+    }
+
+    return NULL;
+}
+
+// prints a warning about a malformed token on the given line.
+static void report(const char* token, size_t length, size_t line) {
+    if(length > MAX_REPORT_LENGTH) length = MAX_REPORT_LENGTH;
+    fprintf(stderr, "line %zu: skipping malformed value '%.*s'\n",
+            line, (int) length, token);
+}
+
+// lazily creates the C locale used by the slow path.
+static locale_t c_locale() {
+    static locale_t locale = 0;
+    if(!locale) locale = newlocale(LC_ALL_MASK, "C", 0);
+    return locale;
+}
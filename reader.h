@@ -0,0 +1,73 @@
+/**
+ *  A block-buffered reader for whitespace-separated numerical data.
+ *  Rather than going through fscanf one number at a time, the reader
+ *  pulls large chunks out of the input with read() and parses the
+ *  numbers directly out of its buffer using a locale-independent
+ *  parser. Commas are treated the same as whitespace, so simple CSV
+ *  files can be read as well. Tokens that are not numbers are
+ *  reported on stderr (together with their line number) and skipped.
+ */
+
+#ifndef READER_H
+#define READER_H
+
+#include "list.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+typedef struct reader {
+    int fd;                         // file descriptor being read
+    char* buffer;                   // raw bytes read from the input
+    size_t start, end, capacity;    // unparsed bytes are [start, end)
+    bool eof;                       // true once read() returns 0
+
+    size_t line;                    // current line, for error output
+    size_t errors;                  // number of malformed tokens
+    bool quiet;                     // if set, errors aren't reported
+} reader;
+
+/**
+ *  Creates a reader that pulls its data from the provided file. The
+ *  reader bypasses the FILE's own buffering, so the file should not
+ *  be read through stdio while the reader is in use.
+ */
+reader* create_reader(FILE* fp);
+
+/**
+ *  Frees the reader and its buffer. The underlying file is left
+ *  open; closing it is the caller's responsibility.
+ */
+void delete_reader(reader* r);
+
+/**
+ *  Reads the next number from the input into *value. Returns false
+ *  once the input is exhausted, in which case *value is untouched.
+ *  Malformed tokens are reported and skipped rather than returned.
+ */
+bool read_value(reader* r, double* value);
+
+/**
+ *  Reads every number in the file, from its current position on,
+ *  into a new value list. Regular files are memory mapped, split into
+ *  newline-aligned chunks and parsed on up to the given number of
+ *  threads (0 means one per online CPU); pipes and terminals are read
+ *  sequentially with a reader instead.
+ */
+value_list* read_all_values(FILE* fp, int threads);
+
+/**
+ *  Reads every pair of numbers in the file into a new point list,
+ *  in the same way as read_all_values. An unpaired value at the very
+ *  end of the input is dropped.
+ */
+point_list* read_all_points(FILE* fp, int threads);
+
+/**
+ *  Parses a single number occupying exactly the characters in
+ *  [s, end). Returns true on success and stores the result in
+ *  *value; returns false if the token is not a valid number.
+ */
+bool parse_value(const char* s, const char* end, double* value);
+
+#endif
@@ -0,0 +1,220 @@
+/**
+ *  Implementation file for selection.h
+ */
+
+#include "selection.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// ranges this short are sorted outright.
+#define SMALL_RANGE 16
+
+// arrays this short are selected from directly by select_ranks, since
+// a sample of them wouldn't be much shorter.
+#define MIN_SAMPLED 65536
+
+// how far either side of a rank its bracket reaches, in standard
+// deviations of the rank in the sample that matches it. a rank falls
+// outside of its bracket with probability well under one in a million.
+#define BRACKET_WIDTH 6
+
+// the number of values scanned between checks that a bracket has room.
+#define SCAN_BLOCK 4096
+
+// Forward declarations of helper functions.
+static double median_of_three(double, double, double);
+static double median_of_medians(double*, size_t);
+static void partition(double*, size_t, double, size_t*, size_t*);
+static void insertion_sort(double*, size_t);
+static void swap(double*, double*);
+static uint64_t next_random(uint64_t*);
+
+/**
+ *  Selects the k-th value by partitioning the range that holds it
+ *  until it's small enough to sort. Each partition is allowed to keep
+ *  up to half of the range, on average; once the partitions have kept
+ *  more than twice that in total, the pivots come from the median of
+ *  medians.
+ */
+double select_nth(double* values, size_t n, size_t k) {
+    double* v = values;
+    size_t lo = 0, hi = n;
+    size_t allowance = 2 * n;
+
+    while(hi - lo > SMALL_RANGE) {
+        size_t size = hi - lo;
+        double pivot = allowance >= size
+                     ? median_of_three(v[lo], v[lo + size / 2], v[hi - 1])
+                     : median_of_medians(v + lo, size);
+
+        // [lo, less) < pivot, [less, more) == pivot, [more, hi) > pivot
+        size_t less, more;
+        partition(v + lo, size, pivot, &less, &more);
+        less += lo;
+        more += lo;
+
+        if(k < less) hi = less;
+        else if(k >= more) lo = more;
+        else return pivot;
+
+        size_t kept = hi - lo;
+        allowance = allowance > kept ? allowance - kept : 0;
+        allowance += size / 2;
+    }
+
+    insertion_sort(v + lo, hi - lo);
+    return v[k];
+}
+
+/**
+ *  Finds several ranks at once. A sample of about n^(2/3) values is
+ *  taken, and each rank is bracketed by the sample values either side
+ *  of where it would be in the sample. A single pass then counts the
+ *  values below each bracket and copies out the ones inside it.
+ */
+void select_ranks(double* values, size_t n, const size_t* ranks,
+                  double* results, int num_ranks) {
+    if(n < MIN_SAMPLED) {
+        for(int i = 0; i < num_ranks; i++)
+            results[i] = select_nth(values, n, ranks[i]);
+        return;
+    }
+
+    size_t s = pow(n, 2.0 / 3);
+    double* sample = malloc(s * sizeof(double));
+    uint64_t state = n;
+    for(size_t i = 0; i < s; i++)
+        sample[i] = values[next_random(&state) % n];
+
+    // a rank's position in the sample has a standard deviation of at
+    // most sqrt(s) / 2
+    size_t reach = BRACKET_WIDTH * sqrt(s) / 2;
+    double* low = malloc(num_ranks * sizeof(double));
+    double* high = malloc(num_ranks * sizeof(double));
+    size_t* below = calloc(num_ranks, sizeof(size_t));
+    size_t* inside = calloc(num_ranks, sizeof(size_t));
+    double** brackets = malloc(num_ranks * sizeof(double*));
+
+    // there are about n / s values per sample value, so about
+    // 2 * reach * n / s in each bracket. there's room for twice that.
+    size_t capacity = 4 * reach * (n / s + 1) + SCAN_BLOCK;
+    for(int i = 0; i < num_ranks; i++) {
+        double at = (double) ranks[i] * s / n;
+        low[i] = at < reach ? -INFINITY
+               : select_nth(sample, s, at - reach);
+        high[i] = at + reach >= s ? INFINITY
+                : select_nth(sample, s, at + reach);
+        brackets[i] = malloc(capacity * sizeof(double));
+    }
+
+    // each value is written to the next free place in the bracket, but
+    // only kept (by moving on) if it's inside, so that there are no
+    // branches to mispredict. the bracket's size is checked a block of
+    // values at a time, and once it might not have room for a whole
+    // block, it's given up on. the counts are kept in locals, since
+    // they'd be reloaded after every write otherwise.
+    for(int i = 0; i < num_ranks; i++) {
+        double lo = low[i], hi = high[i];
+        double* bracket = brackets[i];
+        size_t count = 0, size = 0, start = 0;
+        for(; start < n && size + SCAN_BLOCK <= capacity;
+            start += SCAN_BLOCK) {
+            size_t end = n - start < SCAN_BLOCK ? n : start + SCAN_BLOCK;
+            for(size_t j = start; j < end; j++) {
+                double x = values[j];
+                count += x < lo;
+                bracket[size] = x;
+                size += (x >= lo) & (x <= hi);
+            }
+        }
+
+        below[i] = count;
+        inside[i] = start < n ? capacity : size;
+    }
+
+    for(int i = 0; i < num_ranks; i++) {
+        size_t k = ranks[i] - below[i];
+        if(ranks[i] >= below[i] && k < inside[i] && inside[i] < capacity)
+            results[i] = select_nth(brackets[i], inside[i], k);
+        else
+            results[i] = select_nth(values, n, ranks[i]);
+        free(brackets[i]);
+    }
+
+    free(sample);
+    free(low);
+    free(high);
+    free(below);
+    free(inside);
+    free(brackets);
+}
+
+/** Implementations of helper functions **/
+// the middle one of three values.
+static double median_of_three(double a, double b, double c) {
+    if(a > b) {
+        double t = a;
+        a = b;
+        b = t;
+    }
+    if(b > c) b = c;
+    return a > b ? a : b;
+}
+
+// an approximate median of the n values, which has at least 3/10 of
+// them on each side: the values are split into groups of 5, and this
+// is the median of the groups' medians. the medians are gathered at
+// the start of the values.
+static double median_of_medians(double* v, size_t n) {
+    size_t groups = 0;
+    for(size_t i = 0; i < n; i += 5) {
+        size_t size = n - i < 5 ? n - i : 5;
+        insertion_sort(v + i, size);
+        swap(&v[groups++], &v[i + size / 2]);
+    }
+
+    return select_nth(v, groups, groups / 2);
+}
+
+// partitions the n values into three parts, those less than the
+// pivot, those equal to it and those greater than it, and sets less
+// and more to where the second and third start.
+static void partition(double* v, size_t n, double pivot, size_t* less,
+                      size_t* more) {
+    size_t lt = 0, i = 0, gt = n;
+    while(i < gt) {
+        if(v[i] < pivot) swap(&v[lt++], &v[i++]);
+        else if(v[i] > pivot) swap(&v[i], &v[--gt]);
+        else i++;
+    }
+
+    *less = lt;
+    *more = gt;
+}
+
+// sorts a few values.
+static void insertion_sort(double* v, size_t n) {
+    for(size_t i = 1; i < n; i++) {
+        double x = v[i];
+        size_t j = i;
+        for(; j > 0 && v[j - 1] > x; j--) v[j] = v[j - 1];
+        v[j] = x;
+    }
+}
+
+// swaps two values.
+static void swap(double* a, double* b) {
+    double t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// the next number from a 64-bit linear congruential generator, with
+// the poorly distributed low bits dropped.
+static uint64_t next_random(uint64_t* state) {
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *state >> 16;
+}
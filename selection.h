@@ -0,0 +1,43 @@
+/**
+ *  Linear-time selection: finding the value that would be k-th if an
+ *  array were sorted, without sorting it. This is introselect, which
+ *  is quickselect (partition around a pivot and carry on in the side
+ *  that holds k) with the pivot taken as the median of three values.
+ *  Should that stop shrinking the range quickly enough, the pivots
+ *  are taken as the median of medians instead, which guarantees that
+ *  each partition discards a fixed fraction of it, so the worst case
+ *  is linear as well as the average. Values equal to the pivot are
+ *  gathered in the middle of each partition, so repeated values don't
+ *  slow it down.
+ *
+ *  Selection still reads each value a few times over, and mispredicts
+ *  a branch on most of them. To find a few ranks in a large array in
+ *  about one pass, select_ranks first selects from a random sample of
+ *  it to bracket each rank between two values, then collects the
+ *  values in each bracket in one branchless pass and selects from
+ *  those instead (as Floyd and Rivest do).
+ */
+
+#ifndef SELECTION_H
+#define SELECTION_H
+
+#include <stddef.h>
+
+/**
+ *  Rearranges the n values so that values[k] is the value that would
+ *  be there if they were sorted, with none larger before it and none
+ *  smaller after it, and returns it. The values mustn't be NaN.
+ */
+double select_nth(double* values, size_t n, size_t k);
+
+/**
+ *  Finds the values that would be at each of the given ranks if the n
+ *  values were sorted, storing them in results. Unless a rank turns
+ *  out not to be in its bracket (which is unlikely), the values are
+ *  left as they are; otherwise they're rearranged by select_nth. The
+ *  values mustn't be NaN.
+ */
+void select_ranks(double* values, size_t n, const size_t* ranks,
+                  double* results, int num_ranks);
+
+#endif
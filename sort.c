@@ -0,0 +1,505 @@
+/**
+ *  Implementation file for sort.h
+ */
+
+#include "sort.h"
+#include "list.h"
+#include "reader.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// the radix sort works on 11 bits at a time, so each 64-bit key takes
+// 6 passes. 2048 counters per pass comfortably fit in the L1 cache.
+#define RADIX_BITS 11
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_MASK (RADIX_SIZE - 1)
+#define DIGITS ((64 + RADIX_BITS - 1) / RADIX_BITS)
+
+// if more than 1 in this many points are out of order, the input
+// isn't "nearly sorted" and we may as well radix sort all of it.
+#define STRAGGLER_RATIO 8
+
+// roughly how many bytes sorting one point takes: the coordinates
+// themselves, the scratch space for the radix sort and some slack.
+// this determines how many points go into each run.
+#define BYTES_PER_SORTED_POINT 40
+#define MIN_RUN_POINTS 4096
+
+// the most runs that are merged at once. if there are more runs than
+// this, groups of them are merged into longer runs first, so that we
+// never run out of file descriptors or shrink the blocks too much.
+#define MAX_FAN_IN 128
+#define MIN_BLOCK_POINTS 512
+
+// number of points written to a run file at a time
+#define WRITE_BLOCK 1024
+
+// forward declarations of helper functions
+static int compare_keys(uint64_t, uint64_t, uint64_t, uint64_t);
+static void radix_sort(uint64_t**, uint64_t**, size_t);
+static size_t split_stragglers(uint64_t*, uint64_t*, size_t,
+                               uint64_t*, uint64_t*);
+static void merge_stragglers(uint64_t*, uint64_t*, size_t,
+                             uint64_t*, uint64_t*, size_t);
+static point_stream* create_point_stream();
+static void update_bounds(point_stream*, double, double);
+static FILE* create_temp_file();
+static void write_point(FILE*, double*, size_t*, double, double);
+static void flush_points(FILE*, double*, size_t*);
+static void spill_run(point_stream*, point_list*);
+static void start_merge(point_stream*, size_t);
+static void reduce_runs(point_stream*, size_t);
+static bool advance_run(run*);
+static void sift_down(point_stream*, size_t);
+
+/**
+ *  Sorts a list of points by x-coordinate, breaking ties using the
+ *  y-coordinate.
+ */
+void sort_points(point_list* points) {
+    size_t n = points->size;
+    if(n < 2) return;
+
+    // convert both coordinates to keys, freeing the doubles as we go
+    // so that we never hold more than two copies of the data.
+    uint64_t* kx = malloc(n * sizeof(uint64_t));
+    for(size_t i = 0; i < n; i++) kx[i] = double_to_key(points->x[i]);
+    free(points->x);
+
+    uint64_t* ky = malloc(n * sizeof(uint64_t));
+    for(size_t i = 0; i < n; i++) ky[i] = double_to_key(points->y[i]);
+    free(points->y);
+
+    // fast path: pull out the points that break the ordering. if
+    // there are only a few of them, sort just those and merge them
+    // back in. otherwise, sort everything.
+    size_t limit = n / STRAGGLER_RATIO + 1;
+    uint64_t* sx = malloc(limit * sizeof(uint64_t));
+    uint64_t* sy = malloc(limit * sizeof(uint64_t));
+    size_t stragglers = split_stragglers(kx, ky, n, sx, sy);
+
+    if(stragglers <= n / STRAGGLER_RATIO) {
+        radix_sort(&sx, &sy, stragglers);
+        merge_stragglers(kx, ky, n - stragglers, sx, sy, stragglers);
+    } else radix_sort(&kx, &ky, n);
+
+    free(sx);
+    free(sy);
+
+    // convert back to doubles, again one coordinate at a time.
+    points->x = malloc(points->capacity * sizeof(double));
+    for(size_t i = 0; i < n; i++) points->x[i] = key_to_double(kx[i]);
+    free(kx);
+
+    points->y = malloc(points->capacity * sizeof(double));
+    for(size_t i = 0; i < n; i++) points->y[i] = key_to_double(ky[i]);
+    free(ky);
+}
+
+/**
+ *  Creates a stream that hands out the points of an already sorted
+ *  list, in order. The stream takes ownership of the list.
+ */
+point_stream* stream_points(point_list* points) {
+    point_stream* s = create_point_stream();
+    s->memory = points;
+    s->size = points->size;
+    for(size_t i = 0; i < points->size; i++)
+        update_bounds(s, points->x[i], points->y[i]);
+
+    return s;
+}
+
+/**
+ *  Reads pairs of numbers from the reader and returns a stream of
+ *  them in sorted order, using no more than about max_memory bytes.
+ *  Points are collected into runs that fit in the budget; once a run
+ *  fills up, it's sorted and written out to a temporary file. The
+ *  runs are then merged lazily as the stream is read.
+ */
+point_stream* sort_points_external(reader* r, size_t max_memory) {
+    size_t run_points = max_memory / BYTES_PER_SORTED_POINT;
+    if(run_points < MIN_RUN_POINTS) run_points = MIN_RUN_POINTS;
+
+    point_stream* s = create_point_stream();
+    point_list* buffer = create_point_list();
+    buffer->capacity = run_points;
+    buffer->x = realloc(buffer->x, run_points * sizeof(double));
+    buffer->y = realloc(buffer->y, run_points * sizeof(double));
+
+    double x, y;
+    while(read_value(r, &x) && read_value(r, &y)) {
+        update_bounds(s, x, y);
+        s->size++;
+        append_point_list(buffer, x, y);
+        if(buffer->size < run_points) continue;
+
+        sort_points(buffer);
+        spill_run(s, buffer);
+        buffer->size = 0;
+    }
+
+    // if everything fit in a single run, there's nothing to merge
+    if(s->num_runs == 0) {
+        sort_points(buffer);
+        s->memory = buffer;
+        return s;
+    }
+
+    if(buffer->size > 0) {
+        sort_points(buffer);
+        spill_run(s, buffer);
+    }
+    delete_point_list(buffer);
+
+    while(s->num_runs > MAX_FAN_IN) reduce_runs(s, max_memory);
+    start_merge(s, max_memory);
+    return s;
+}
+
+/**
+ *  Retrieves the next point from the stream. Returns false once all
+ *  of the points have been handed out.
+ */
+bool next_point(point_stream* s, double* x, double* y) {
+    if(s->memory) {
+        if(s->position >= s->memory->size) return false;
+        *x = s->memory->x[s->position];
+        *y = s->memory->y[s->position];
+        s->position++;
+        return true;
+    }
+
+    // take the smallest head off the heap and advance its run. if
+    // that run is exhausted, replace it with the last one in the heap.
+    if(s->heap_size == 0) return false;
+    run* top = &s->runs[s->heap[0]];
+    *x = key_to_double(top->head_x);
+    *y = key_to_double(top->head_y);
+
+    if(!advance_run(top)) s->heap[0] = s->heap[--s->heap_size];
+    sift_down(s, 0);
+    return true;
+}
+
+/**
+ *  Frees a point stream, along with any temporary files it used.
+ */
+void delete_point_stream(point_stream* s) {
+    if(s->memory) delete_point_list(s->memory);
+
+    for(size_t i = 0; i < s->num_runs; i++) {
+        fclose(s->runs[i].file);
+        free(s->runs[i].buffer);
+    }
+
+    free(s->runs);
+    free(s->heap);
+    free(s);
+}
+
+/**
+ *  Maps a double onto an unsigned integer with the same ordering.
+ *  Positive numbers just need their sign bit set so that they come
+ *  after the negatives; negative numbers are stored as sign and
+ *  magnitude, so all of their bits get flipped.
+ */
+uint64_t double_to_key(double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return (bits >> 63) ? ~bits : bits | (UINT64_C(1) << 63);
+}
+
+/**
+ *  The inverse of double_to_key.
+ */
+double key_to_double(uint64_t key) {
+    uint64_t bits = (key >> 63) ? key & ~(UINT64_C(1) << 63) : ~key;
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+/** Implementations of helper functions **/
+// compares the points with keys (x1, y1) and (x2, y2) by x, then y.
+static int compare_keys(uint64_t x1, uint64_t y1,
+                        uint64_t x2, uint64_t y2) {
+    if(x1 != x2) return x1 < x2 ? -1 : 1;
+    if(y1 != y2) return y1 < y2 ? -1 : 1;
+    return 0;
+}
+
+// least-significant-digit radix sort on the 128-bit key (x, y). the
+// y digits go first since they're the least significant. passes in
+// which every key has the same digit are skipped entirely. the
+// sorted keys may end up in freshly allocated arrays, which is why
+// the arrays are passed by reference.
+static void radix_sort(uint64_t** kx, uint64_t** ky, size_t n) {
+    if(n < 2) return;
+
+    // count every digit of every key in a single pass
+    size_t (*counts)[RADIX_SIZE] = calloc(2 * DIGITS, sizeof(*counts));
+    for(size_t i = 0; i < n; i++) {
+        for(int d = 0; d < DIGITS; d++) {
+            counts[d][((*ky)[i] >> (d * RADIX_BITS)) & RADIX_MASK]++;
+            counts[DIGITS + d]
+                  [((*kx)[i] >> (d * RADIX_BITS)) & RADIX_MASK]++;
+        }
+    }
+
+    uint64_t* tx = malloc(n * sizeof(uint64_t));
+    uint64_t* ty = malloc(n * sizeof(uint64_t));
+
+    for(int pass = 0; pass < 2 * DIGITS; pass++) {
+        const uint64_t* key = pass < DIGITS ? *ky : *kx;
+        int shift = (pass % DIGITS) * RADIX_BITS;
+        size_t* count = counts[pass];
+        if(count[(key[0] >> shift) & RADIX_MASK] == n) continue;
+
+        // turn the counts into starting offsets, then scatter
+        size_t sum = 0;
+        for(int b = 0; b < RADIX_SIZE; b++) {
+            size_t c = count[b];
+            count[b] = sum;
+            sum += c;
+        }
+
+        for(size_t i = 0; i < n; i++) {
+            size_t dest = count[(key[i] >> shift) & RADIX_MASK]++;
+            tx[dest] = (*kx)[i];
+            ty[dest] = (*ky)[i];
+        }
+
+        uint64_t* temp = *kx; *kx = tx; tx = temp;
+        temp = *ky; *ky = ty; ty = temp;
+    }
+
+    free(tx);
+    free(ty);
+    free(counts);
+}
+
+// walks through the points once, compacting the ones that are in
+// order with respect to the last point kept to the front of the
+// arrays. the rest are copied into (sx, sy) until that fills up.
+// returns the number of stragglers, or n if the straggler arrays
+// overflowed; in that case all of the points are left in the
+// original arrays (in some order).
+static size_t split_stragglers(uint64_t* kx, uint64_t* ky, size_t n,
+                               uint64_t* sx, uint64_t* sy) {
+    size_t kept = 1, stragglers = 0, limit = n / STRAGGLER_RATIO;
+
+    for(size_t i = 1; i < n; i++) {
+        if(compare_keys(kx[kept - 1], ky[kept - 1],
+                        kx[i], ky[i]) <= 0) {
+            kx[kept] = kx[i];
+            ky[kept] = ky[i];
+            kept++;
+        } else if(stragglers < limit) {
+            sx[stragglers] = kx[i];
+            sy[stragglers] = ky[i];
+            stragglers++;
+        } else {
+            // too many stragglers: put the ones we've set aside back
+            // and give up on the fast path. since every point so far
+            // was either kept or set aside, they fit exactly in the
+            // gap between the kept points and point i.
+            memcpy(kx + kept, sx, stragglers * sizeof(uint64_t));
+            memcpy(ky + kept, sy, stragglers * sizeof(uint64_t));
+            return n;
+        }
+    }
+
+    return stragglers;
+}
+
+// merges the sorted stragglers back into the first `kept` points of
+// (kx, ky). this works from the back so it can be done in place: the
+// arrays have exactly enough room for both.
+static void merge_stragglers(uint64_t* kx, uint64_t* ky, size_t kept,
+                             uint64_t* sx, uint64_t* sy, size_t num) {
+    size_t dest = kept + num;
+    while(num > 0) {
+        if(kept > 0 && compare_keys(kx[kept - 1], ky[kept - 1],
+                                    sx[num - 1], sy[num - 1]) > 0) {
+            kept--;
+            kx[--dest] = kx[kept];
+            ky[dest] = ky[kept];
+        } else {
+            num--;
+            kx[--dest] = sx[num];
+            ky[dest] = sy[num];
+        }
+    }
+}
+
+// creates an empty point stream with empty bounds.
+static point_stream* create_point_stream() {
+    point_stream* s = calloc(1, sizeof(point_stream));
+    s->x_min = s->y_min = INFINITY;
+    s->x_max = s->y_max = -INFINITY;
+    return s;
+}
+
+// grows the stream's bounds to include the point (x, y).
+static void update_bounds(point_stream* s, double x, double y) {
+    if(x < s->x_min) s->x_min = x;
+    if(x > s->x_max) s->x_max = x;
+    if(y < s->y_min) s->y_min = y;
+    if(y > s->y_max) s->y_max = y;
+}
+
+// creates an anonymous temporary file for a run. the file is unlinked
+// straight away, so it disappears as soon as it's closed.
+static FILE* create_temp_file() {
+    const char* dir = getenv("TMPDIR");
+    if(dir == NULL || *dir == 0) dir = "/tmp";
+
+    char* path = malloc(strlen(dir) + 32);
+    sprintf(path, "%s/cuniplot-XXXXXX", dir);
+    int fd = mkstemp(path);
+    if(fd < 0) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    unlink(path);
+    FILE* fp = fdopen(fd, "w+b");
+    if(fp == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    free(path);
+    return fp;
+}
+
+// buffers a point for writing to a run file, flushing the buffer
+// once it's full. the buffer holds WRITE_BLOCK interleaved pairs.
+static void write_point(FILE* fp, double* block, size_t* count,
+                        double x, double y) {
+    block[2 * *count] = x;
+    block[2 * *count + 1] = y;
+    if(++*count == WRITE_BLOCK) flush_points(fp, block, count);
+}
+
+// writes out any points that are still buffered.
+static void flush_points(FILE* fp, double* block, size_t* count) {
+    if(fwrite(block, 2 * sizeof(double), *count, fp) != *count) {
+        perror("writing temporary file");
+        exit(EXIT_FAILURE);
+    }
+    *count = 0;
+}
+
+// writes a sorted list of points out to a new run at the end of the
+// stream's list of runs.
+static void spill_run(point_stream* s, point_list* points) {
+    s->runs = realloc(s->runs, (s->num_runs + 1) * sizeof(run));
+    run* r = &s->runs[s->num_runs++];
+    memset(r, 0, sizeof(run));
+    r->file = create_temp_file();
+
+    double block[2 * WRITE_BLOCK];
+    size_t count = 0;
+    for(size_t i = 0; i < points->size; i++)
+        write_point(r->file, block, &count, points->x[i], points->y[i]);
+    flush_points(r->file, block, &count);
+}
+
+// rewinds each of the stream's runs, gives each of them a read buffer
+// (splitting half of the memory budget between them) and arranges
+// them into a heap keyed by their first points.
+static void start_merge(point_stream* s, size_t max_memory) {
+    size_t block = max_memory / 2 / (2 * sizeof(double) * s->num_runs);
+    if(block < MIN_BLOCK_POINTS) block = MIN_BLOCK_POINTS;
+
+    s->heap = malloc(s->num_runs * sizeof(size_t));
+    s->heap_size = 0;
+    for(size_t i = 0; i < s->num_runs; i++) {
+        run* r = &s->runs[i];
+        rewind(r->file);
+        r->capacity = block;
+        r->buffer = malloc(block * 2 * sizeof(double));
+        r->size = r->position = 0;
+        if(advance_run(r)) s->heap[s->heap_size++] = i;
+    }
+
+    for(size_t i = s->heap_size; i-- > 0;) sift_down(s, i);
+}
+
+// merges groups of MAX_FAN_IN runs together, cutting the number of
+// runs down by that factor.
+static void reduce_runs(point_stream* s, size_t max_memory) {
+    size_t num_merged = (s->num_runs + MAX_FAN_IN - 1) / MAX_FAN_IN;
+    run* merged = calloc(num_merged, sizeof(run));
+
+    for(size_t i = 0; i < num_merged; i++) {
+        // a stream over just this group of runs
+        point_stream group = { 0 };
+        group.runs = s->runs + i * MAX_FAN_IN;
+        group.num_runs = s->num_runs - i * MAX_FAN_IN;
+        if(group.num_runs > MAX_FAN_IN) group.num_runs = MAX_FAN_IN;
+        start_merge(&group, max_memory);
+
+        merged[i].file = create_temp_file();
+        double block[2 * WRITE_BLOCK], x, y;
+        size_t count = 0;
+        while(next_point(&group, &x, &y))
+            write_point(merged[i].file, block, &count, x, y);
+        flush_points(merged[i].file, block, &count);
+
+        for(size_t j = 0; j < group.num_runs; j++) {
+            fclose(group.runs[j].file);
+            free(group.runs[j].buffer);
+        }
+        free(group.heap);
+    }
+
+    free(s->runs);
+    s->runs = merged;
+    s->num_runs = num_merged;
+}
+
+// loads the next point of a run into its head, reading in the next
+// block of the file if needed. returns false if the run is empty.
+static bool advance_run(run* r) {
+    if(r->position == r->size) {
+        r->size = fread(r->buffer, 2 * sizeof(double), r->capacity,
+                        r->file);
+        r->position = 0;
+        if(r->size == 0) return false;
+    }
+
+    r->head_x = double_to_key(r->buffer[2 * r->position]);
+    r->head_y = double_to_key(r->buffer[2 * r->position + 1]);
+    r->position++;
+    return true;
+}
+
+// restores the heap property below the given index of the heap.
+static void sift_down(point_stream* s, size_t index) {
+    while(true) {
+        size_t smallest = index;
+        for(size_t child = 2 * index + 1;
+            child <= 2 * index + 2 && child < s->heap_size; child++) {
+            run* a = &s->runs[s->heap[child]];
+            run* b = &s->runs[s->heap[smallest]];
+            if(compare_keys(a->head_x, a->head_y,
+                            b->head_x, b->head_y) < 0)
+                smallest = child;
+        }
+
+        if(smallest == index) return;
+        size_t temp = s->heap[index];
+        s->heap[index] = s->heap[smallest];
+        s->heap[smallest] = temp;
+        index = smallest;
+    }
+}
@@ -0,0 +1,91 @@
+/**
+ *  Sorting routines for point lists. Points are ordered first by their
+ *  x-coordinate and then by their y-coordinate, which is the order the
+ *  interpolation in graph.c expects. Rather than comparing points one
+ *  pair at a time, the coordinates are turned into unsigned integers
+ *  with the same ordering and radix sorted, which takes linear time.
+ *
+ *  Inputs that don't fit in memory can be sorted externally: sorted
+ *  runs are spilled to temporary files and merged back together as
+ *  the points are consumed. Either way, the sorted points are handed
+ *  out one at a time by a point_stream.
+ */
+
+#ifndef SORT_H
+#define SORT_H
+
+#include "list.h"
+#include "reader.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// a sorted run of points in a temporary file, read back in blocks.
+typedef struct run {
+    FILE* file;
+    double* buffer;                 // interleaved (x, y) pairs
+    size_t size, position, capacity;
+    uint64_t head_x, head_y;        // keys of the next point
+} run;
+
+// a stream of points in sorted order. the points either live in
+// memory, or are merged on the fly from a heap of runs.
+typedef struct point_stream {
+    size_t size;                    // total number of points
+    double x_min, x_max, y_min, y_max;
+
+    point_list* memory;             // if everything fit in memory
+    size_t position;
+
+    run* runs;                      // otherwise, the runs to merge
+    size_t* heap;
+    size_t num_runs, heap_size;
+} point_stream;
+
+/**
+ *  Sorts a list of points by x-coordinate, breaking ties using the
+ *  y-coordinate. Input that is already sorted, or that only has a few
+ *  points out of place, is detected and handled in a single pass plus
+ *  a small amount of extra work for the stragglers.
+ */
+void sort_points(point_list* points);
+
+/**
+ *  Creates a stream that hands out the points of an already sorted
+ *  list, in order. The stream takes ownership of the list.
+ */
+point_stream* stream_points(point_list* points);
+
+/**
+ *  Reads pairs of numbers from the reader until it's exhausted and
+ *  returns a stream of them in sorted order, using no more than
+ *  roughly max_memory bytes. If the points don't fit, sorted runs
+ *  are written to temporary files (in $TMPDIR, or /tmp) and merged
+ *  as the stream is read.
+ */
+point_stream* sort_points_external(reader* r, size_t max_memory);
+
+/**
+ *  Retrieves the next point from the stream. Returns false once all
+ *  of the points have been handed out.
+ */
+bool next_point(point_stream* s, double* x, double* y);
+
+/**
+ *  Frees a point stream, along with any temporary files it used.
+ */
+void delete_point_stream(point_stream* s);
+
+/**
+ *  Maps a double onto an unsigned integer such that comparing the
+ *  integers gives the same result as comparing the doubles.
+ */
+uint64_t double_to_key(double d);
+
+/**
+ *  The inverse of double_to_key.
+ */
+double key_to_double(uint64_t key);
+
+#endif
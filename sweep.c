@@ -0,0 +1,164 @@
+/**
+ *  Implementation file for sweep.h
+ */
+
+#include "expression.h"
+#include "sweep.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// what a part of the expression depends on.
+#define ON_X            1
+#define ON_PARAMETER    2
+
+// Forward declarations of helper functions.
+static int plan(sweep*, expression*, size_t*, int*);
+static void operand(sweep*, int, const double**, size_t*);
+static double apply(enum operators, double, double);
+
+/**
+ *  Prepares to evaluate an expression at the given points, working
+ *  out which of its nodes need to be evaluated separately.
+ */
+sweep* create_sweep(expression* e, const double* xs, size_t n) {
+    sweep* s = malloc(sizeof(sweep));
+    s->num_points = n;
+    s->nodes = NULL;
+    s->num_nodes = 0;
+
+    size_t capacity = 0;
+    int depends;
+    plan(s, e, &capacity, &depends);
+
+    for(size_t i = 0; i < s->num_nodes; i++) {
+        sweep_node* node = &s->nodes[i];
+        if(node->kind == FIXED) continue;
+
+        node->values = malloc(n * sizeof(double));
+        if(node->kind == CACHED) {
+            for(size_t j = 0; j < n; j++)
+                node->values[j] = evaluate(node->e, xs[j]);
+        }
+    }
+
+    return s;
+}
+
+/**
+ *  Frees a sweep created by create_sweep.
+ */
+void delete_sweep(sweep* s) {
+    for(size_t i = 0; i < s->num_nodes; i++)
+        free(s->nodes[i].values);
+    free(s->nodes);
+    free(s);
+}
+
+/**
+ *  Evaluates the expression at every point. The nodes are visited
+ *  in order, so the operands of a mixed node are always up to date
+ *  by the time it's reached.
+ */
+void run_sweep(sweep* s, double* ys) {
+    size_t n = s->num_points;
+
+    for(size_t i = 0; i < s->num_nodes; i++) {
+        sweep_node* node = &s->nodes[i];
+        if(node->kind == FIXED) node->value = evaluate(node->e, 0);
+        if(node->kind != MIXED) continue;
+
+        const double* l, * r;
+        size_t l_step, r_step;
+        operand(s, node->left, &l, &l_step);
+        operand(s, node->right, &r, &r_step);
+
+        enum operators op = node->e->operation;
+        for(size_t j = 0; j < n; j++)
+            node->values[j] = apply(op, l[j * l_step], r[j * r_step]);
+    }
+
+    sweep_node* root = &s->nodes[s->num_nodes - 1];
+    if(root->kind == FIXED) {
+        for(size_t j = 0; j < n; j++) ys[j] = root->value;
+    } else memcpy(ys, root->values, n * sizeof(double));
+}
+
+/** Implementations of helper functions **/
+// appends the nodes needed to evaluate e to the sweep, operands first,
+// and returns the index of e's node. what e depends on is stored in
+// depends. only mixed nodes keep the nodes for their operands; any
+// other node is evaluated as a whole.
+static int plan(sweep* s, expression* e, size_t* capacity, int* depends) {
+    size_t start = s->num_nodes;
+    int left = -1, right = -1, l = 0, r = 0;
+    if(e->left != NULL) left = plan(s, e->left, capacity, &l);
+    if(e->right != NULL) right = plan(s, e->right, capacity, &r);
+
+    *depends = l | r;
+    if(e->operation == VARIABLE) *depends = ON_X;
+    if(e->operation == PARAMETER) *depends = ON_PARAMETER;
+
+    enum sweep_kind kind = MIXED;
+    if(!(*depends & ON_X)) kind = FIXED;
+    else if(!(*depends & ON_PARAMETER)) kind = CACHED;
+
+    if(kind != MIXED) {
+        s->num_nodes = start;
+        left = right = -1;
+    }
+
+    if(s->num_nodes == *capacity) {
+        *capacity = *capacity ? 2 * *capacity : 16;
+        s->nodes = realloc(s->nodes, *capacity * sizeof(sweep_node));
+    }
+
+    s->nodes[s->num_nodes] = (sweep_node) { kind, e, left, right, 0, NULL };
+    return s->num_nodes++;
+}
+
+// finds the values of an operand: a single value for a fixed node (or
+// a missing one), or one value per point otherwise. step is how far
+// apart consecutive points' values are.
+static void operand(sweep* s, int index, const double** values,
+                    size_t* step) {
+    static const double zero = 0;
+    if(index < 0) {
+        *values = &zero;
+        *step = 0;
+    } else if(s->nodes[index].kind == FIXED) {
+        *values = &s->nodes[index].value;
+        *step = 0;
+    } else {
+        *values = s->nodes[index].values;
+        *step = 1;
+    }
+}
+
+// applies an operator to the values of its operands, exactly as
+// evaluate does.
+static double apply(enum operators op, double l, double r) {
+    switch(op) {
+        case ADD:       return l + r;
+        case SUBTRACT:  return l - r;
+        case MULTIPLY:  return l * r;
+        case DIVIDE:    return l / r;
+        case POWER:     return pow(l, r);
+
+        case SINE:      return sin(l);
+        case COSINE:    return cos(l);
+        case TANGENT:   return tan(l);
+        case SECANT:    return 1.0 / cos(l);
+        case COSECANT:  return 1.0 / sin(l);
+        case COTANGENT: return 1.0 / tan(l);
+
+        case ARCSIN:    return asin(l);
+        case ARCCOS:    return acos(l);
+        case ARCTAN:    return atan(l);
+
+        case LOG:       return log(l);
+        case EXP:       return exp(l);
+        default:        return 0;   // leaves are never mixed
+    }
+}
@@ -0,0 +1,66 @@
+/**
+ *  Evaluation of an expression with a parameter over a fixed set of
+ *  points, for many values of the parameter in turn (like the frames
+ *  of an animation of sin(a * x) as a changes). Rather than evaluating
+ *  the whole expression for each value, its parts are split by what
+ *  they depend on:
+ *
+ *   - parts that only depend on x are evaluated at every point once,
+ *     and the values are reused for every value of the parameter,
+ *   - parts that don't depend on x are evaluated once per value of
+ *     the parameter, rather than once per point, and
+ *   - only the operators that combine the two are applied at every
+ *     point for every value of the parameter.
+ *
+ *  The values are computed exactly as evaluate would.
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "expression.h"
+
+#include <stddef.h>
+
+// how a node in the expression is evaluated.
+enum sweep_kind {
+    FIXED,          // doesn't depend on x, so has one value at a time
+    CACHED,         // only depends on x, so its values never change
+    MIXED           // depends on both, so is recomputed at each point
+};
+
+typedef struct sweep_node {
+    enum sweep_kind kind;
+    expression* e;
+
+    // for MIXED nodes, the nodes of the operands (or -1 for none)
+    int left, right;
+
+    double value;   // for FIXED nodes
+    double* values; // for CACHED and MIXED nodes, one per point
+} sweep_node;
+
+typedef struct sweep {
+    size_t num_points;
+    sweep_node* nodes;  // operands before operators, the root last
+    size_t num_nodes;
+} sweep;
+
+/**
+ *  Prepares to evaluate an expression at the given points. The parts
+ *  that only depend on x are evaluated right away.
+ */
+sweep* create_sweep(expression* e, const double* xs, size_t n);
+
+/**
+ *  Frees a sweep created by create_sweep.
+ */
+void delete_sweep(sweep* s);
+
+/**
+ *  Evaluates the expression at every point, with the parameters at
+ *  their current values, storing the results in ys.
+ */
+void run_sweep(sweep* s, double* ys);
+
+#endif
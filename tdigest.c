@@ -0,0 +1,193 @@
+/**
+ *  Implementation file for tdigest.h
+ */
+
+#include "tdigest.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the number of values buffered for each unit of compression. larger
+// buffers mean fewer (but larger) merges.
+#define BUFFER_FACTOR 5
+
+// Forward declarations of helper functions.
+static void compress(tdigest*, const centroid*, int);
+static double limit(double, double);
+static int compare_centroids(const void*, const void*);
+
+/**
+ *  Creates an empty digest.
+ */
+tdigest* create_tdigest(double compression) {
+    tdigest* d = malloc(sizeof(tdigest));
+    d->compression = compression;
+    d->centroids = NULL;
+    d->num_centroids = 0;
+    d->buffer_size = BUFFER_FACTOR * compression;
+    d->buffer = malloc(d->buffer_size * sizeof(double));
+    d->buffered = 0;
+    d->total = 0;
+    d->min = INFINITY;
+    d->max = -INFINITY;
+    return d;
+}
+
+/**
+ *  Frees a digest created by create_tdigest.
+ */
+void delete_tdigest(tdigest* d) {
+    free(d->centroids);
+    free(d->buffer);
+    free(d);
+}
+
+/**
+ *  Adds a value to the digest's buffer, merging the buffer into the
+ *  centroids once it's full.
+ */
+void add_to_digest(tdigest* d, double x) {
+    if(!isfinite(x)) return;
+
+    d->total++;
+    if(x < d->min) d->min = x;
+    if(x > d->max) d->max = x;
+
+    d->buffer[d->buffered++] = x;
+    if(d->buffered == d->buffer_size) compress(d, NULL, 0);
+}
+
+/**
+ *  Adds everything in other to d, by merging other's centroids in
+ *  along with d's buffer.
+ */
+void merge_digests(tdigest* d, tdigest* other) {
+    compress(other, NULL, 0);
+    add_centroids(d, other->centroids, other->num_centroids, other->min,
+                  other->max);
+}
+
+/**
+ *  Adds the centroids to the digest by merging them in along with its
+ *  buffer. Each one stands for as many values as its weight.
+ */
+void add_centroids(tdigest* d, const centroid* c, int n, double min,
+                   double max) {
+    if(n == 0) return;
+    compress(d, c, n);
+
+    for(int i = 0; i < n; i++) d->total += c[i].weight;
+    if(min < d->min) d->min = min;
+    if(max > d->max) d->max = max;
+}
+
+/**
+ *  Merges the buffered values into the centroids.
+ */
+void flush_digest(tdigest* d) {
+    compress(d, NULL, 0);
+}
+
+/**
+ *  Estimates a quantile by finding the centroids either side of it
+ *  and interpolating between their means. Each centroid's values are
+ *  taken to be spread evenly around its mean, so its mean is at the
+ *  middle of its share of the ranks.
+ */
+double digest_quantile(tdigest* d, double q) {
+    compress(d, NULL, 0);
+    if(d->num_centroids == 0) return NAN;
+    if(q <= 0) return d->min;
+    if(q >= 1) return d->max;
+
+    centroid* c = d->centroids;
+    int n = d->num_centroids;
+    double rank = q * d->total;
+
+    // the rank at the middle of the current centroid
+    double middle = c[0].weight / 2;
+    double estimate;
+    if(rank < middle)
+        estimate = d->min + (c[0].mean - d->min) * rank / middle;
+    else {
+        int i = 0;
+        double next = middle;
+        for(; i + 1 < n; i++, middle = next) {
+            next = middle + (c[i].weight + c[i + 1].weight) / 2;
+            if(rank < next) break;
+        }
+
+        if(i + 1 < n)
+            estimate = c[i].mean + (c[i + 1].mean - c[i].mean) *
+                       (rank - middle) / (next - middle);
+        else
+            estimate = c[i].mean + (d->max - c[i].mean) *
+                       (rank - middle) / (c[i].weight / 2);
+    }
+
+    return fmin(fmax(estimate, d->min), d->max);
+}
+
+/** Implementations of helper functions **/
+// merges the buffered values, and any extra centroids, into the
+// digest's centroids. everything is sorted together, then neighbouring
+// centroids are combined from left to right for as long as the result
+// stays within the size limit where it starts.
+static void compress(tdigest* d, const centroid* extra, int num_extra) {
+    if(d->buffered == 0 && num_extra == 0) return;
+
+    int n = d->num_centroids + d->buffered + num_extra;
+    centroid* all = realloc(d->centroids, n * sizeof(centroid));
+    centroid* c = all + d->num_centroids;
+    for(int i = 0; i < d->buffered; i++)
+        c[i] = (centroid) { d->buffer[i], 1 };
+    if(num_extra > 0)
+        memcpy(c + d->buffered, extra, num_extra * sizeof(centroid));
+    qsort(all, n, sizeof(centroid), compare_centroids);
+
+    double total = 0;
+    for(int i = 0; i < n; i++) total += all[i].weight;
+
+    // every combined centroid is written at or before the ones still
+    // to be read, so this can be done in place
+    int size = 0;
+    centroid current = all[0];
+    double before = 0, most = total * limit(0, d->compression);
+    for(int i = 1; i < n; i++) {
+        if(before + current.weight + all[i].weight <= most) {
+            current.weight += all[i].weight;
+            current.mean += (all[i].mean - current.mean) * all[i].weight /
+                            current.weight;
+            continue;
+        }
+
+        all[size++] = current;
+        before += current.weight;
+        most = total * limit(before / total, d->compression);
+        current = all[i];
+    }
+    all[size++] = current;
+
+    d->centroids = realloc(all, size * sizeof(centroid));
+    d->num_centroids = size;
+    d->buffered = 0;
+}
+
+// the quantile that a centroid starting at quantile q can reach. the
+// size of the centroids is governed by the scale
+//     k(q) = compression / (2 pi) * asin(2q - 1),
+// and a centroid can span at most 1 on this scale.
+static double limit(double q, double compression) {
+    if(q >= 1) return 1;
+    double k = compression / (2 * M_PI) * asin(2 * q - 1) + 1;
+    if(k >= compression / 4) return 1;
+    return (sin(k * 2 * M_PI / compression) + 1) / 2;
+}
+
+// compares centroids by their means, for qsort.
+static int compare_centroids(const void* a, const void* b) {
+    double x = ((const centroid*) a)->mean;
+    double y = ((const centroid*) b)->mean;
+    return (x > y) - (x < y);
+}
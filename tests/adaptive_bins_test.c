@@ -0,0 +1,169 @@
+/**
+ *  Checks that read_bins (see adaptive_bins.h) reads back what
+ *  write_bins wrote, for empty bins, bins holding a single value and
+ *  bins holding many, with and without a digest, and that it rejects
+ *  files whose header doesn't agree with itself or with the counts and
+ *  centroids that follow it.
+ */
+
+#include "adaptive_bins.h"
+#include "tdigest.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define NUM_BINS    64
+#define NUM_VALUES  10000
+
+// a change to otherwise valid bins that should make them invalid. the
+// last one keeps the counts adding up to the total.
+typedef struct tampering {
+    const char* name;
+    void (*apply)(adaptive_bins*);
+} tampering;
+
+static void odd_width(adaptive_bins* b) { b->width *= 1.5; }
+static void shifted_origin(adaptive_bins* b) { b->origin += b->width / 2; }
+static void nan_min(adaptive_bins* b) { b->min = NAN; }
+static void infinite_max(adaptive_bins* b) { b->max = INFINITY; }
+static void min_above_max(adaptive_bins* b) { b->min = b->max + 1; }
+static void min_below_bins(adaptive_bins* b) { b->min = b->origin - 1; }
+static void extra_count(adaptive_bins* b) { b->counts[3] += 1; }
+static void extra_total(adaptive_bins* b) { b->total += 1; }
+static void negative_count(adaptive_bins* b) {
+    b->counts[4] += b->counts[3] + 1;
+    b->counts[3] = -1;
+}
+
+static const tampering TAMPERINGS[] = {
+    { "width isn't a power of two", odd_width },
+    { "origin isn't a multiple of the width", shifted_origin },
+    { "min isn't a number", nan_min },
+    { "max is infinite", infinite_max },
+    { "min is above max", min_above_max },
+    { "min is below the bins", min_below_bins },
+    { "counts add up to more than the total", extra_count },
+    { "total is more than the counts add up to", extra_total },
+    { "a count is negative", negative_count }
+};
+#define NUM_TAMPERINGS (sizeof(TAMPERINGS) / sizeof(TAMPERINGS[0]))
+
+static adaptive_bins* filled_bins(tdigest*);
+static bool round_trip(const char*, adaptive_bins*, const char*);
+static bool digest_round_trip(const char*);
+static bool extra_value_rejected(const char*);
+
+int main() {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/adaptive_bins_test.%d", getpid());
+    bool passed = true;
+
+    adaptive_bins* b = create_adaptive_bins(NUM_BINS);
+    passed &= round_trip("empty bins", b, path);
+    add_to_bins(b, 2.5);
+    add_to_bins(b, 2.5);
+    passed &= round_trip("bins with a single value", b, path);
+    delete_adaptive_bins(b);
+
+    b = filled_bins(NULL);
+    passed &= round_trip("bins with many values", b, path);
+    delete_adaptive_bins(b);
+    passed &= digest_round_trip(path);
+
+    for(size_t i = 0; i < NUM_TAMPERINGS; i++) {
+        b = filled_bins(NULL);
+        TAMPERINGS[i].apply(b);
+        write_bins(b, NULL, path);
+        adaptive_bins* read = read_bins(path, NULL);
+
+        printf("%-44s %s\n", TAMPERINGS[i].name,
+               read == NULL ? "rejected" : "ACCEPTED");
+        passed &= read == NULL;
+        if(read != NULL) delete_adaptive_bins(read);
+        delete_adaptive_bins(b);
+    }
+    passed &= extra_value_rejected(path);
+
+    unlink(path);
+    if(!passed) {
+        printf("FAIL: partial histograms aren't checked properly\n");
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
+
+// bins holding values from a skewed distribution, on both sides of 0,
+// which are added to the digest too if there is one
+static adaptive_bins* filled_bins(tdigest* d) {
+    adaptive_bins* b = create_adaptive_bins(NUM_BINS);
+    srand(1);
+    for(int i = 0; i < NUM_VALUES; i++) {
+        double x = exp(4.0 * rand() / RAND_MAX) - 3;
+        add_to_bins(b, x);
+        if(d != NULL) add_to_digest(d, x);
+    }
+    return b;
+}
+
+// writes the bins, and checks that they read back the same
+static bool round_trip(const char* name, adaptive_bins* b,
+                       const char* path) {
+    write_bins(b, NULL, path);
+    adaptive_bins* read = read_bins(path, NULL);
+
+    bool same = read != NULL && read->num_bins == b->num_bins &&
+                read->total == b->total && read->origin == b->origin &&
+                read->width == b->width && read->min == b->min &&
+                read->max == b->max;
+    for(int i = 0; same && i < b->num_bins; i++)
+        same = read->counts[i] == b->counts[i];
+
+    printf("%-44s %s\n", name, same ? "read back" : "NOT READ BACK");
+    if(read != NULL) delete_adaptive_bins(read);
+    return same;
+}
+
+// writes bins with a digest, and checks that the digest reads back
+// with the same quantiles
+static bool digest_round_trip(const char* path) {
+    tdigest* d = create_tdigest(200);
+    adaptive_bins* b = filled_bins(d);
+    write_bins(b, d, path);
+
+    tdigest* saved;
+    adaptive_bins* read = read_bins(path, &saved);
+    bool same = read != NULL && saved != NULL && saved->total == d->total;
+    for(double q = 0; same && q <= 1; q += 0.001)
+        same = digest_quantile(saved, q) == digest_quantile(d, q);
+
+    printf("%-44s %s\n", "bins with a digest",
+           same ? "read back" : "NOT READ BACK");
+    if(read != NULL) delete_adaptive_bins(read);
+    if(saved != NULL) delete_tdigest(saved);
+    delete_adaptive_bins(b);
+    delete_tdigest(d);
+    return same;
+}
+
+// writes bins with a digest of one more value than they hold
+static bool extra_value_rejected(const char* path) {
+    tdigest* d = create_tdigest(200);
+    adaptive_bins* b = filled_bins(d);
+    add_to_digest(d, 1);
+    write_bins(b, d, path);
+
+    tdigest* saved = NULL;
+    adaptive_bins* read = read_bins(path, &saved);
+    printf("%-44s %s\n", "digest has a value the bins don't",
+           read == NULL ? "rejected" : "ACCEPTED");
+
+    bool rejected = read == NULL;
+    if(read != NULL) delete_adaptive_bins(read);
+    if(saved != NULL) delete_tdigest(saved);
+    delete_adaptive_bins(b);
+    delete_tdigest(d);
+    return rejected;
+}
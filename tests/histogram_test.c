@@ -0,0 +1,146 @@
+/**
+ *  Checks that bins chosen with --bins and --log-bins (see
+ *  hist_options.h) change the histogram that's drawn, on lognormal
+ *  values, which are skewed enough that every rule picks different
+ *  bins from the plot's own. Log bins have to be drawn on a log x axis,
+ *  where the values peak around 1, and a fixed number of bins has to
+ *  be drawn as that many flat bars.
+ */
+
+#include "histogram.h"
+#include "hist_options.h"
+#include "list.h"
+#include "plot_options.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_VALUES  300000
+#define WIDTH       50
+#define HEIGHT      6
+#define NUM_FIXED   10
+
+// bins chosen some way, other than the plot's own
+typedef struct rule {
+    const char* name;
+    enum bin_rule bin_rule;
+    int num_bins;
+    bool log_bins;
+} rule;
+
+static const rule RULES[] = {
+    { "--log-bins", SCREEN_BINS, 0, true },
+    { "--bins fd", FD_BINS, 0, false },
+    { "--bins sturges", STURGES_BINS, 0, false },
+    { "--bins 10", FIXED_BINS, NUM_FIXED, false }
+};
+#define NUM_RULES (sizeof(RULES) / sizeof(RULES[0]))
+
+static const char** draw(FILE*, const rule*);
+static double* bin(double*, const rule*, plot_options*);
+
+int main() {
+    double* values = malloc(NUM_VALUES * sizeof(double));
+    FILE* input = tmpfile();
+    srand(1);
+    for(int i = 0; i < NUM_VALUES; i++) {
+        double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+        double v = rand() / (RAND_MAX + 1.0);
+        values[i] = exp(sqrt(-2 * log(u)) * cos(2 * M_PI * v));
+        fprintf(input, "%.17g\n", values[i]);
+    }
+
+    bool passed = true;
+    const char** plain = draw(input, NULL);
+    for(size_t i = 0; i < NUM_RULES; i++) {
+        const char** chosen = draw(input, &RULES[i]);
+        int differences = 0;
+        for(int cell = 0; cell < WIDTH * HEIGHT; cell++)
+            differences += strcmp(plain[cell], chosen[cell]) != 0;
+
+        printf("%-16s %3d cells differ from the default\n", RULES[i].name,
+               differences);
+        passed &= differences > 0;
+        free(chosen);
+    }
+    free(plain);
+
+    // on a log axis, the tallest bar is where log(x) peaks, at 0
+    plot_options plot_opts;
+    double* bars = bin(values, &RULES[0], &plot_opts);
+    int tallest = 0;
+    for(int i = 0; i < 2 * WIDTH; i++)
+        if(bars[i] > bars[tallest]) tallest = i;
+    double span = log(plot_opts.x_max / plot_opts.x_min) / (2 * WIDTH);
+    double peak = log(plot_opts.x_min) + (tallest + 0.5) * span;
+
+    printf("--log-bins       %s axis, peaks at %.3g\n",
+           plot_opts.x_log ? "log" : "LINEAR", exp(peak));
+    passed &= plot_opts.x_log && fabs(peak) < 0.5;
+    free(bars);
+
+    // each fixed bin is a flat bar, so there are no more heights than
+    // there are bins
+    bars = bin(values, &RULES[NUM_RULES - 1], &plot_opts);
+    int heights = 0;
+    for(int i = 0; i < 2 * WIDTH; i++)
+        heights += i == 0 || bars[i] != bars[i - 1];
+
+    printf("--bins 10        %d different heights\n", heights);
+    passed &= heights <= NUM_FIXED;
+    free(bars);
+
+    fclose(input);
+    free(values);
+    if(!passed) {
+        printf("FAIL: chosen bins aren't drawn as chosen\n");
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
+
+// draws a histogram of the values in the file with the bins chosen by
+// the rule, or the plot's own bins if there's no rule.
+static const char** draw(FILE* input, const rule* r) {
+    hist_options hist_opts = default_hist_options();
+    if(r != NULL) {
+        hist_opts.bin_rule = r->bin_rule;
+        hist_opts.num_bins = r->num_bins;
+        hist_opts.log_bins = r->log_bins;
+    }
+
+    plot_options plot_opts = default_plot_options();
+    plot_opts.width = WIDTH;
+    plot_opts.height = HEIGHT;
+    plot_opts.data_input = input;
+    rewind(input);
+
+    return data_to_histogram(&hist_opts, &plot_opts);
+}
+
+// bins a copy of the values as the rule says, on a plot spanning them.
+static double* bin(double* values, const rule* r, plot_options* plot_opts) {
+    hist_options hist_opts = default_hist_options();
+    hist_opts.bin_rule = r->bin_rule;
+    hist_opts.num_bins = r->num_bins;
+    hist_opts.log_bins = r->log_bins;
+
+    value_list data = { NUM_VALUES, NUM_VALUES,
+                        malloc(NUM_VALUES * sizeof(double)) };
+    memcpy(data.data, values, NUM_VALUES * sizeof(double));
+
+    *plot_opts = default_plot_options();
+    plot_opts->width = WIDTH;
+    plot_opts->x_min = plot_opts->x_max = values[0];
+    for(int i = 0; i < NUM_VALUES; i++) {
+        plot_opts->x_min = fmin(plot_opts->x_min, values[i]);
+        plot_opts->x_max = fmax(plot_opts->x_max, values[i]);
+    }
+
+    double* bars = get_freqs(&data, &hist_opts, NULL, plot_opts);
+    free(data.data);
+    return bars;
+}
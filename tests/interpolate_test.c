@@ -0,0 +1,117 @@
+/**
+ *  Checks the windowed spline that's used for externally sorted
+ *  streams against a full solve over the same points (which is what
+ *  points in memory get), on knots with very uneven spacing. The last
+ *  case is outside of what the window is meant to handle (the spacing
+ *  grows by 15 orders of magnitude within a margin), so its error is
+ *  only reported.
+ */
+
+#include "graph_options.h"
+#include "interpolate.h"
+#include "list.h"
+#include "reader.h"
+#include "sort.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_POINTS  50000
+#define NUM_SAMPLES 200000
+
+// the largest error allowed, relative to the range of the data
+#define TOLERANCE   1e-9
+
+// Forward declarations of helper functions.
+static double check(const char*, double (*)(int));
+static double even(int);
+static double uneven(int);
+static double clustered(int);
+static double ramp(int);
+static double steep_ramp(int);
+
+int main() {
+    srand(1);
+    double worst = 0;
+    worst = fmax(worst, check("even", even));
+    worst = fmax(worst, check("uneven", uneven));
+    worst = fmax(worst, check("clustered", clustered));
+    worst = fmax(worst, check("ramp", ramp));
+    check("steep ramp", steep_ramp);
+
+    if(worst > TOLERANCE) {
+        printf("FAIL: windowed spline is off by %g\n", worst);
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
+
+/** Implementations of helper functions **/
+// interpolates the same points with a full solve and with windows,
+// and returns the largest difference relative to the range of y.
+static double check(const char* name, double (*spacing)(int)) {
+    point_list* points = create_point_list();
+    FILE* f = tmpfile();
+    double x = 0;
+    for(int i = 0; i < NUM_POINTS; i++) {
+        double y = sin(x / 50) + (double) rand() / RAND_MAX;
+        append_point_list(points, x, y);
+        fprintf(f, "%.17g %.17g\n", x, y);
+        x += spacing(i);
+    }
+    rewind(f);
+
+    double* xs = malloc(NUM_SAMPLES * sizeof(double));
+    double* full = malloc(NUM_SAMPLES * sizeof(double));
+    double* windowed = malloc(NUM_SAMPLES * sizeof(double));
+    for(int i = 0; i < NUM_SAMPLES; i++)
+        xs[i] = x * i / (NUM_SAMPLES - 1);
+
+    point_stream* memory = stream_points(points);
+    interpolate(SPLINE, memory, xs, full, NUM_SAMPLES);
+
+    // the smallest budget, so that the points are spilled to runs
+    reader* r = create_reader(f);
+    point_stream* external = sort_points_external(r, 1);
+    interpolate(SPLINE, external, xs, windowed, NUM_SAMPLES);
+
+    double error = 0, range = memory->y_max - memory->y_min;
+    for(int i = 0; i < NUM_SAMPLES; i++)
+        error = fmax(error, fabs(full[i] - windowed[i]) / range);
+    printf("%-12s largest relative error %g\n", name, error);
+
+    delete_point_stream(memory);
+    delete_point_stream(external);
+    delete_reader(r);
+    fclose(f);
+    free(xs);
+    free(full);
+    free(windowed);
+    return error;
+}
+
+// every knot the same distance apart.
+static double even(int i) {
+    return 1;
+}
+
+// spacings spread log-uniformly over six orders of magnitude.
+static double uneven(int i) {
+    return pow(10, 6.0 * rand() / RAND_MAX - 3);
+}
+
+// bursts of very closely spaced knots, separated by long gaps.
+static double clustered(int i) {
+    return i % 100 == 0 ? 1000 : 1e-4;
+}
+
+// spacings that grow geometrically and then drop back, over and over.
+static double ramp(int i) {
+    return 1e-6 * pow(1.3, i % 80);
+}
+
+// a ramp so steep that the margin isn't enough.
+static double steep_ramp(int i) {
+    return 1e-15 * pow(1.6, i % 130);
+}
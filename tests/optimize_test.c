@@ -0,0 +1,159 @@
+/**
+ *  Checks that optimised programs (see optimize.h) compute the same
+ *  values as evaluate. Constant folding, shared subexpressions and
+ *  the reciprocal trig rewrites have to match exactly. Unrolled
+ *  integer powers and reassociated constants are allowed to differ
+ *  by a few ulp, since they round differently; they're checked on
+ *  expressions where nothing cancels afterwards, so the relative
+ *  error stays that small. Programs that read a parameter as they run
+ *  have to match exactly as the parameter changes. The JIT, where it's
+ *  available, has to match the stack machine exactly.
+ */
+
+#include "expression.h"
+#include "jit.h"
+#include "optimize.h"
+#include "program.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_SAMPLES 100000
+
+// the largest relative error allowed for the inexact rewrites
+#define TOLERANCE   1e-14
+
+static const char* EXACT[] = {
+    "x",
+    "2 + 3 * 4 - x",
+    "sin(x) + sin(x) * cos(x) - sin(x) / cos(x)",
+    "sec(x) + cos(x) * tan(x) - cot(x) + csc(x) * sin(x)",
+    "exp(log(x) * 2) + (x + 1) * (x + 1) / (x + 1)",
+    "asin(x / 5) + acos(x / 5) - atan(x) ^ 0.5",
+    "x ^ 2.5 + x ^ -0.5 + 2 ^ x + x ^ 20",
+    "log(1 + 2) * sin(3) + x"
+};
+#define NUM_EXACT (sizeof(EXACT) / sizeof(EXACT[0]))
+
+static const char* APPROXIMATE[] = {
+    "x ^ 2 + x ^ 3 + x ^ 8",
+    "x ^ -3 + x ^ -7",
+    "2 * 3 * x + 5 * 7 * x * x + 100",
+    "exp(x) ^ 5 * 2 * 0.1 * x ^ 4"
+};
+#define NUM_APPROXIMATE (sizeof(APPROXIMATE) / sizeof(APPROXIMATE[0]))
+
+// expressions with a parameter a, and the values it's given in turn
+static const char* WITH_PARAMETER[] = {
+    "sin(a * x) * x",
+    "x ^ a + a * x - sec(a) * cos(x)",
+    "tan(a / x) + exp(a) * log(a * a + x * x)"
+};
+#define NUM_WITH_PARAMETER \
+    (sizeof(WITH_PARAMETER) / sizeof(WITH_PARAMETER[0]))
+static const double VALUES[] = { 0.5, 1.7, -2.3, 0 };
+#define NUM_VALUES (sizeof(VALUES) / sizeof(VALUES[0]))
+
+// Forward declarations of helper functions.
+static bool check(const char*, bool);
+static bool check_parameter(const char*);
+static bool same(double, double);
+
+int main() {
+    bool passed = true;
+    for(int i = 0; i < NUM_EXACT; i++)
+        passed &= check(EXACT[i], true);
+    for(int i = 0; i < NUM_APPROXIMATE; i++)
+        passed &= check(APPROXIMATE[i], false);
+    for(int i = 0; i < NUM_WITH_PARAMETER; i++)
+        passed &= check_parameter(WITH_PARAMETER[i]);
+
+    if(!passed) {
+        printf("FAIL: optimised programs differ from evaluate\n");
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
+
+/** Implementations of helper functions **/
+// compares the optimised program (and its JIT) with evaluate for x
+// between -5 and 5, printing the number of mismatches.
+static bool check(const char* s, bool exact) {
+    expression_arena* arena = create_arena();
+    expression* e = parse_expression(s, arena);
+    if(e == NULL) {
+        printf("%-52s doesn't parse\n", s);
+        delete_arena(arena);
+        return false;
+    }
+
+    program* p = optimize_expression(e);
+    jit* j = compile_jit(p);
+
+    int wrong = 0, jit_wrong = 0;
+    double worst = 0;
+    for(int i = 0; i < NUM_SAMPLES; i++) {
+        double x = -5 + 10.0 * i / NUM_SAMPLES;
+        double expected = evaluate(e, x), actual = run_program(p, x);
+        if(j != NULL && !same(j->function(x), actual)) jit_wrong++;
+
+        if(same(expected, actual)) continue;
+        double error = fabs(actual - expected) / fabs(expected);
+        if(exact || !(error <= TOLERANCE)) wrong++;
+        if(error > worst) worst = error;
+    }
+
+    printf("%-52s %s, %d wrong (worst %.2g)", s,
+           exact ? "exact" : "approximate", wrong, worst);
+    if(j != NULL) printf(", %d wrong in the jit", jit_wrong);
+    printf("\n");
+
+    if(j != NULL) delete_jit(j);
+    delete_program(p);
+    delete_arena(arena);
+    return wrong == 0 && jit_wrong == 0;
+}
+
+// compiles an expression in x and a once, with a read as the program
+// runs, and compares it with evaluate for each of the values of a.
+static bool check_parameter(const char* s) {
+    expression_arena* arena = create_arena();
+    const char* names[] = { "a" };
+    expression* a;
+    expression* e = parse_with_parameters(s, names, 1, &a, arena);
+    if(e == NULL) {
+        printf("%-52s doesn't parse\n", s);
+        delete_arena(arena);
+        return false;
+    }
+
+    program* p = optimize_with_parameters(e);
+    jit* j = compile_jit(p);
+
+    int wrong = 0, jit_wrong = 0;
+    for(int k = 0; k < NUM_VALUES; k++) {
+        a->value = VALUES[k];
+        for(int i = 0; i < NUM_SAMPLES; i++) {
+            double x = -5 + 10.0 * i / NUM_SAMPLES;
+            double actual = run_program(p, x);
+            if(!same(evaluate(e, x), actual)) wrong++;
+            if(j != NULL && !same(j->function(x), actual)) jit_wrong++;
+        }
+    }
+
+    printf("%-52s parameter, %d wrong", s, wrong);
+    if(j != NULL) printf(", %d wrong in the jit", jit_wrong);
+    printf("\n");
+
+    if(j != NULL) delete_jit(j);
+    delete_program(p);
+    delete_arena(arena);
+    return wrong == 0 && jit_wrong == 0;
+}
+
+// checks whether two results are the same, counting NaNs as equal.
+static bool same(double a, double b) {
+    return a == b || (isnan(a) && isnan(b));
+}
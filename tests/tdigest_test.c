@@ -0,0 +1,127 @@
+/**
+ *  Checks the quantiles estimated by t-digests (see tdigest.h) against
+ *  a sorted copy of the values, for uniform and lognormal values and
+ *  for digests merged from several built separately. The error is
+ *  measured in ranks: how far the fraction of the values below the
+ *  estimate is from the quantile asked for. It has to stay within the
+ *  bound tdigest.h documents, pi sqrt(q (1 - q)) / d for compression d.
+ */
+
+#include "tdigest.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define COMPRESSION 200
+#define NUM_VALUES  1000000
+#define NUM_SHARDS  16
+
+static const double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+#define NUM_QUANTILES (sizeof(QUANTILES) / sizeof(QUANTILES[0]))
+
+static double uniform();
+static double lognormal();
+static bool check(const char*, tdigest*, double*, size_t);
+static int compare_doubles(const void*, const void*);
+
+int main() {
+    double* values = malloc(NUM_VALUES * sizeof(double));
+    bool passed = true;
+    srand(1);
+
+    tdigest* d = create_tdigest(COMPRESSION);
+    for(size_t i = 0; i < NUM_VALUES; i++) {
+        values[i] = uniform();
+        add_to_digest(d, values[i]);
+    }
+    passed &= check("uniform", d, values, NUM_VALUES);
+    delete_tdigest(d);
+
+    d = create_tdigest(COMPRESSION);
+    for(size_t i = 0; i < NUM_VALUES; i++) {
+        values[i] = lognormal();
+        add_to_digest(d, values[i]);
+    }
+    passed &= check("lognormal", d, values, NUM_VALUES);
+    delete_tdigest(d);
+
+    // shards that overlap, but each of which is spread differently
+    d = create_tdigest(COMPRESSION);
+    for(int shard = 0; shard < NUM_SHARDS; shard++) {
+        tdigest* part = create_tdigest(COMPRESSION);
+        size_t start = (size_t) NUM_VALUES * shard / NUM_SHARDS;
+        size_t stop = (size_t) NUM_VALUES * (shard + 1) / NUM_SHARDS;
+        for(size_t i = start; i < stop; i++) {
+            values[i] = lognormal() * (shard + 1);
+            add_to_digest(part, values[i]);
+        }
+        merge_digests(d, part);
+        delete_tdigest(part);
+    }
+    passed &= check("merged lognormal shards", d, values, NUM_VALUES);
+    delete_tdigest(d);
+
+    free(values);
+    if(!passed) {
+        printf("FAIL: quantiles are off by more than the bound\n");
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
+
+// a value spread uniformly over [0, 1)
+static double uniform() {
+    return rand() / (RAND_MAX + 1.0);
+}
+
+// a value whose log is standard normal (box-muller)
+static double lognormal() {
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return exp(sqrt(-2 * log(u)) * cos(2 * M_PI * uniform()));
+}
+
+// compares each estimated quantile with the ranks of the estimate in
+// the sorted values. any rank from the number of values below it to
+// the number at or below it is exact.
+static bool check(const char* name, tdigest* d, double* values, size_t n) {
+    qsort(values, n, sizeof(double), compare_doubles);
+    bool passed = true;
+
+    printf("%-24s", name);
+    for(size_t i = 0; i < NUM_QUANTILES; i++) {
+        double q = QUANTILES[i];
+        double estimate = digest_quantile(d, q);
+
+        // a binary search for the first value that isn't below it
+        size_t below = 0;
+        for(size_t step = n; step > 0; step /= 2) {
+            while(below + step <= n && values[below + step - 1] < estimate)
+                below += step;
+        }
+        size_t at_or_below = below;
+        while(at_or_below < n && values[at_or_below] == estimate)
+            at_or_below++;
+
+        double rank = q * n, error = 0;
+        if(rank < below) error = (below - rank) / n;
+        if(rank > at_or_below) error = (rank - at_or_below) / n;
+
+        double bound = M_PI * sqrt(q * (1 - q)) / COMPRESSION;
+        printf("  p%g %.4f%% (%.4f%%)", 100 * q, 100 * error, 100 * bound);
+        if(error > bound) {
+            printf(" TOO FAR");
+            passed = false;
+        }
+    }
+    printf("\n");
+
+    return passed;
+}
+
+// compares doubles, for qsort.
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
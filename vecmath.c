@@ -0,0 +1,288 @@
+/**
+ *  Implementation file for vecmath.h
+ */
+
+#include "vecmath.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+// every exported function gets a copy for each of these targets.
+#define CLONES \
+    __attribute__((target_clones("avx512f", "avx2", "default")))
+
+// and the kernels are inlined into each of those copies. since they
+// never get called as real functions, the warnings about their ABI
+// for targets without wide vectors don't apply (hence -Wno-psabi).
+#define KERNEL static inline __attribute__((always_inline))
+
+// adding and then subtracting this rounds to the nearest integer, and
+// leaves that integer in the low bits of the sum.
+#define ROUNDER 0x1.8p52
+
+// the two halves of ln(2) and the three parts of pi/2 used in range
+// reductions, split so that multiplying them by a small integer is
+// exact.
+#define LN2_HI  6.93147180369123816490e-01
+#define LN2_LO  1.90821492927058770002e-10
+#define PIO2_1  1.57079632673412561417e+00
+#define PIO2_2  6.07710050630396597660e-11
+#define PIO2_3  2.02226624871116645580e-21
+
+// past this, the reduction for sin and cos loses too much accuracy
+#define MAX_TRIG_ARGUMENT 1e5
+
+// Forward declarations of helper functions.
+KERNEL vdouble blend(vlong, vdouble, vdouble);
+KERNEL vdouble splat(double);
+KERNEL vdouble scale(vdouble, vlong);
+KERNEL vdouble exp_kernel(vdouble);
+KERNEL vdouble log_kernel(vdouble);
+KERNEL vdouble sin_kernel(vdouble);
+KERNEL vdouble cos_kernel(vdouble);
+KERNEL vdouble reduce_trig(vdouble, vlong*);
+KERNEL vdouble load(const double*);
+KERNEL void store(double*, vdouble);
+KERNEL void trig_fallback(double*, vdouble, double (*)(double));
+
+/**
+ *  Replaces every value in the array with its sine.
+ */
+CLONES void vec_sin(double* values, size_t n) {
+    for(size_t i = 0; i < n; i += LANES) {
+        vdouble x = load(values + i);
+        vlong quadrant;
+        vdouble r = reduce_trig(x, &quadrant);
+        vdouble s = sin_kernel(r), c = cos_kernel(r);
+
+        // sin(x) is s, c, -s or -c depending on the quadrant.
+        vdouble y = blend(quadrant & 1, c, s);
+        store(values + i, blend(quadrant & 2, -y, y));
+        trig_fallback(values + i, x, sin);
+    }
+}
+
+/**
+ *  Replaces every value in the array with its cosine.
+ */
+CLONES void vec_cos(double* values, size_t n) {
+    for(size_t i = 0; i < n; i += LANES) {
+        vdouble x = load(values + i);
+        vlong quadrant;
+        vdouble r = reduce_trig(x, &quadrant);
+        vdouble s = sin_kernel(r), c = cos_kernel(r);
+
+        // cos(x) is c, -s, -c or s depending on the quadrant.
+        vdouble y = blend(quadrant & 1, s, c);
+        store(values + i, blend((quadrant + 1) & 2, -y, y));
+        trig_fallback(values + i, x, cos);
+    }
+}
+
+/**
+ *  Replaces every value in the array with its tangent.
+ */
+CLONES void vec_tan(double* values, size_t n) {
+    for(size_t i = 0; i < n; i += LANES) {
+        vdouble x = load(values + i);
+        vlong quadrant;
+        vdouble r = reduce_trig(x, &quadrant);
+        vdouble s = sin_kernel(r), c = cos_kernel(r);
+
+        // tan(x) is s/c in even quadrants and -c/s in odd ones.
+        store(values + i, blend(quadrant & 1, -c / s, s / c));
+        trig_fallback(values + i, x, tan);
+    }
+}
+
+/**
+ *  Replaces every value in the array with its exponential.
+ */
+CLONES void vec_exp(double* values, size_t n) {
+    for(size_t i = 0; i < n; i += LANES)
+        store(values + i, exp_kernel(load(values + i)));
+}
+
+/**
+ *  Replaces every value in the array with its natural logarithm.
+ */
+CLONES void vec_log(double* values, size_t n) {
+    for(size_t i = 0; i < n; i += LANES)
+        store(values + i, log_kernel(load(values + i)));
+}
+
+/**
+ *  Raises every value in the first array to the power of the value
+ *  in the same position in the second.
+ */
+CLONES void vec_pow(double* bases, const double* exponents, size_t n) {
+    for(size_t i = 0; i < n; i += LANES) {
+        vdouble x = load(bases + i), y = load(exponents + i);
+
+        // for positive bases, x^y = e^(y ln x). exp magnifies the
+        // rounding error in y ln x, so only use this while the
+        // exponent stays small; everything else goes to libm.
+        vdouble z = y * log_kernel(x);
+        vdouble result = exp_kernel(z);
+        vlong fast = (x > 0) & (x < INFINITY) & (z > -1) & (z < 1);
+
+        // squares are by far the most common power, and x * x is
+        // exactly what pow would return for them.
+        vlong square = y == 2;
+        result = blend(square, x * x, result);
+
+        for(int j = 0; j < LANES; j++) {
+            if(!fast[j] && !square[j]) result[j] = pow(x[j], y[j]);
+        }
+        store(bases + i, result);
+    }
+}
+
+/** Implementations of helper functions **/
+// picks the value from a in lanes where the mask is set, and from b
+// everywhere else.
+KERNEL vdouble blend(vlong mask, vdouble a, vdouble b) {
+    mask = mask != 0;
+    return (vdouble) ((mask & (vlong) a) | (~mask & (vlong) b));
+}
+
+// a vector with every lane set to d.
+KERNEL vdouble splat(double d) {
+    return (vdouble) { 0 } + d;
+}
+
+// multiplies x by 2^k, for |k| up to about 2000. the scaling is done
+// in two halves so that neither factor overflows on its own.
+KERNEL vdouble scale(vdouble x, vlong k) {
+    vlong half = k >> 1;
+    vdouble a = (vdouble) ((half + 1023) << 52);
+    vdouble b = (vdouble) ((k - half + 1023) << 52);
+    return x * a * b;
+}
+
+// e^x. writing x = k ln(2) + r with |r| <= ln(2) / 2, e^x is 2^k e^r
+// where e^r comes from its Taylor series.
+KERNEL vdouble exp_kernel(vdouble x) {
+    // outside this range the result is 0 or infinite anyway
+    x = blend(x > 746, splat(746), x);
+    x = blend(x < -746, splat(-746), x);
+
+    vdouble kd = x * M_LOG2E + ROUNDER;
+    vlong k = (vlong) kd - (vlong) splat(ROUNDER);
+    kd -= ROUNDER;
+    vdouble r = (x - kd * LN2_HI) - kd * LN2_LO;
+
+    // 1 + r + r^2/2! + ... + r^13/13!, by Horner's method
+    vdouble p = splat(1.0 / 6227020800);
+    static const double TAYLOR[] = {
+        1.0 / 479001600, 1.0 / 39916800, 1.0 / 3628800,
+        1.0 / 362880, 1.0 / 40320, 1.0 / 5040, 1.0 / 720,
+        1.0 / 120, 1.0 / 24, 1.0 / 6, 1.0 / 2, 1, 1
+    };
+    for(int i = 0; i < 13; i++) p = p * r + TAYLOR[i];
+
+    return scale(p, k);
+}
+
+// ln(x), using the same method as fdlibm: x = 2^k m with m between
+// sqrt(1/2) and sqrt(2), and ln(m) = 2 atanh(s) for s = (m-1)/(m+1),
+// which has a quickly converging series.
+KERNEL vdouble log_kernel(vdouble x) {
+    static const double LG[] = {
+        1.479819860511658591e-01, 1.531383769920937332e-01,
+        1.818357216161805012e-01, 2.222219843214978396e-01,
+        2.857142874366239149e-01, 3.999999999940941908e-01,
+        6.666666666666735130e-01
+    };
+
+    // bring subnormals into the normal range first
+    vlong tiny = x < 0x1p-1022;
+    vdouble y = blend(tiny, x * 0x1p54, x);
+    vlong bits = (vlong) y;
+    vlong k = ((bits >> 52) & 0x7ff) - 1023;
+    k -= tiny & 54;
+
+    // m in [1, 2), then halved if it's past sqrt(2)
+    vdouble m = (vdouble) ((bits & 0xfffffffffffff) |
+                           0x3ff0000000000000);
+    vlong big = m > M_SQRT2;
+    m = blend(big, m * 0.5, m);
+    k -= big;
+
+    vdouble f = m - 1;
+    vdouble s = f / (2 + f);
+    vdouble z = s * s;
+    vdouble r = splat(LG[0]);
+    for(int i = 1; i < 7; i++) r = r * z + LG[i];
+    r *= z;
+
+    vdouble kd = __builtin_convertvector(k, vdouble);
+    vdouble hfsq = 0.5 * f * f;
+    vdouble result = kd * LN2_HI -
+                     ((hfsq - (s * (hfsq + r) + kd * LN2_LO)) - f);
+
+    // special cases: negative, zero, infinite and NaN inputs
+    result = blend(x < 0, splat(NAN), result);
+    result = blend(x == 0, splat(-INFINITY), result);
+    result = blend(x == INFINITY, x, result);
+    return blend(x != x, x, result);
+}
+
+// sin(r) for |r| <= pi/4, using the polynomial from fdlibm.
+KERNEL vdouble sin_kernel(vdouble r) {
+    vdouble z = r * r;
+    vdouble p = 1.58969099521155010221e-10 * z
+                - 2.50507602534068634195e-08;
+    p = p * z + 2.75573137070700676789e-06;
+    p = p * z - 1.98412698298579493134e-04;
+    p = p * z + 8.33333333332248946124e-03;
+    return r + z * r * (p * z - 1.66666666666666324348e-01);
+}
+
+// cos(r) for |r| <= pi/4, using the polynomial from fdlibm.
+KERNEL vdouble cos_kernel(vdouble r) {
+    vdouble z = r * r;
+    vdouble p = -1.13596475577881948265e-11 * z
+                + 2.08757232129817482790e-09;
+    p = p * z - 2.75573143513906633035e-07;
+    p = p * z + 2.48015872894767294178e-05;
+    p = p * z - 1.38888888888741095749e-03;
+    p = p * z + 4.16666666666666019037e-02;
+    p *= z;
+
+    vdouble hz = 0.5 * z;
+    vdouble w = 1 - hz;
+    return w + (((1 - w) - hz) + z * p);
+}
+
+// writes x = k pi/2 + r with |r| <= pi/4, returning r and storing k
+// (of which only the last two bits matter).
+KERNEL vdouble reduce_trig(vdouble x, vlong* k) {
+    vdouble kd = x * M_2_PI + ROUNDER;
+    *k = (vlong) kd;
+    kd -= ROUNDER;
+    return ((x - kd * PIO2_1) - kd * PIO2_2) - kd * PIO2_3;
+}
+
+// recomputes the lanes whose arguments were too big (or not finite)
+// for the vectorised reduction using libm.
+KERNEL void trig_fallback(double* values, vdouble x,
+                          double (*f)(double)) {
+    vlong far = ~((x > -MAX_TRIG_ARGUMENT) & (x < MAX_TRIG_ARGUMENT));
+    for(int j = 0; j < LANES; j++) {
+        if(far[j]) values[j] = f(x[j]);
+    }
+}
+
+// loads LANES doubles from a possibly unaligned address.
+KERNEL vdouble load(const double* p) {
+    vdouble v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// stores LANES doubles to a possibly unaligned address.
+KERNEL void store(double* p, vdouble v) {
+    memcpy(p, &v, sizeof(v));
+}
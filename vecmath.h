@@ -0,0 +1,63 @@
+/**
+ *  Vectorised versions of the elementary functions used by compiled
+ *  expressions. Each function works in place on an array of values,
+ *  LANES at a time, using GCC's vector extensions. They are built
+ *  for several instruction sets (AVX-512, AVX2 and plain SSE2), and
+ *  the best one that the CPU supports is picked when the program
+ *  starts.
+ *
+ *  The kernels use the same range reductions and polynomials as the
+ *  usual scalar implementations and are accurate to within an ulp or
+ *  two, but aren't guaranteed to round identically to libm. Inputs
+ *  the reductions can't handle accurately (e.g. huge arguments to
+ *  sin) are passed on to libm instead.
+ */
+
+#ifndef VECMATH_H
+#define VECMATH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// the number of doubles handled at once. arrays passed to the
+// functions below must have a length that is a multiple of this.
+#define LANES 8
+
+typedef double vdouble
+    __attribute__((vector_size(LANES * sizeof(double))));
+typedef int64_t vlong
+    __attribute__((vector_size(LANES * sizeof(int64_t))));
+
+/**
+ *  Replaces every value in the array with its sine.
+ */
+void vec_sin(double* values, size_t n);
+
+/**
+ *  Replaces every value in the array with its cosine.
+ */
+void vec_cos(double* values, size_t n);
+
+/**
+ *  Replaces every value in the array with its tangent.
+ */
+void vec_tan(double* values, size_t n);
+
+/**
+ *  Replaces every value in the array with its exponential.
+ */
+void vec_exp(double* values, size_t n);
+
+/**
+ *  Replaces every value in the array with its natural logarithm.
+ */
+void vec_log(double* values, size_t n);
+
+/**
+ *  Raises every value in the first array to the power of the value
+ *  in the same position in the second, storing the results in the
+ *  first array.
+ */
+void vec_pow(double* bases, const double* exponents, size_t n);
+
+#endif